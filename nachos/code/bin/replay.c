@@ -0,0 +1,280 @@
+/* replay.c 
+ *
+ * This program reads a page reference trace written by "nachos -tr",
+ * and reports the number of page faults FIFO, LRU, CLOCK, RANDOM and
+ * Belady's OPT would have taken with every memory size from 1 to
+ * <maxFrames> frames, so that one run of Nachos can stand in for a
+ * run per policy and size.
+ *
+ * LRU and OPT are stack algorithms: with n+1 frames, memory always
+ * holds what it would have held with n, plus one page.  The fault
+ * counts for all sizes then follow from the stack distance of each
+ * reference, computed in a single pass over the trace (Mattson et
+ * al., 1970); OPT keeps its stack ordered by time of next reference,
+ * found by a backward pass.  FIFO, CLOCK and RANDOM are not stack
+ * algorithms, and are simulated once for each size.
+ *
+ * A page is a (pid, virtual page) pair, so code pages shared through
+ * the text page cache count once per process.  Like LRU_CLOCK in
+ * Nachos, CLOCK sets the reference bit of a page it loads.
+ *
+ * Copyright (c) 1992-1993 The Regents of the University of California.
+ * All rights reserved.  See copyright.h for copyright notice and limitation 
+ * of liability and disclaimer of warranty provisions.
+ */
+
+#define MAIN
+#include "copyright.h" 
+#undef MAIN
+
+#include <sys/types.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+#define NEVER	0x7fffffff	/* next reference of a page never used again */
+
+int numRefs;			/* references in the trace */
+int *refs;			/* the page of each, numbered from 0 */
+int numPages;			/* distinct pages */
+int firstTick, lastTick;
+
+/* Hash table numbering the (pid, vpn) pairs */
+int hashSize;
+int *hashKey, *hashPage;
+
+void *
+Alloc(int nBytes)
+{
+    void *p = malloc(nBytes);
+
+    if (p == NULL) {
+	fprintf(stderr, "Out of memory\n");
+	exit(1);
+    }
+    return p;
+}
+
+/* Number the page "key", giving it the next number if it is new */
+int
+PageNumber(int key)
+{
+    int i, *oldKey, *oldPage, oldSize;
+
+    if (2 * numPages >= hashSize) {		/* keep it half empty */
+	oldKey = hashKey; oldPage = hashPage; oldSize = hashSize;
+	hashSize = (hashSize == 0) ? 1024 : 2 * hashSize;
+	hashKey = (int *) Alloc(hashSize * sizeof(int));
+	hashPage = (int *) Alloc(hashSize * sizeof(int));
+	for (i = 0; i < hashSize; i++)
+	    hashPage[i] = -1;
+	for (i = 0; i < oldSize; i++)
+	    if (oldPage[i] != -1) {
+		int h = (unsigned) oldKey[i] * 2654435761u % hashSize;
+		while (hashPage[h] != -1) h = (h + 1) % hashSize;
+		hashKey[h] = oldKey[i];
+		hashPage[h] = oldPage[i];
+	    }
+	free(oldKey); free(oldPage);
+    }
+    for (i = (unsigned) key * 2654435761u % hashSize; hashPage[i] != -1;
+						i = (i + 1) % hashSize)
+	if (hashKey[i] == key)
+	    return hashPage[i];
+    hashKey[i] = key;
+    hashPage[i] = numPages;
+    return numPages++;
+}
+
+/* Read the whole trace into "refs"; return the traced memory size */
+int
+ReadTrace(char *name)
+{
+    TraceHeader header;
+    TraceRecord buf[1024];
+    int fd, n, i, maxRefs = 0;
+
+    fd = open(name, O_RDONLY, 0);
+    if (fd == -1) {
+	perror(name);
+	exit(1);
+    }
+    if ((read(fd, (char *) &header, sizeof(header)) != sizeof(header))
+				|| (header.traceMagic != TRACEMAGIC)) {
+	fprintf(stderr, "%s is not a Nachos page reference trace\n", name);
+	exit(1);
+    }
+    while ((n = read(fd, (char *) buf, sizeof(buf))) > 0) {
+	n /= sizeof(TraceRecord);
+	for (i = 0; i < n; i++) {
+	    if (numRefs == maxRefs) {
+		maxRefs = (maxRefs == 0) ? 65536 : 2 * maxRefs;
+		refs = (int *) realloc(refs, maxRefs * sizeof(int));
+		if (refs == NULL) {
+		    fprintf(stderr, "Out of memory\n");
+		    exit(1);
+		}
+	    }
+	    if (numRefs == 0) firstTick = buf[i].tick;
+	    lastTick = buf[i].tick;
+	    refs[numRefs++] = PageNumber((buf[i].pid << 16)
+					| (buf[i].page & ~TRACE_WRITE));
+	}
+    }
+    close(fd);
+    return header.numPhysPages;
+}
+
+/* LRU: "hist[d]" counts the references at stack distance d, 1 <= d <=
+ * numPages; first references (infinite distance) go in hist[0].
+ */
+void
+LruDistances(int *hist)
+{
+    int *stack = (int *) Alloc(numPages * sizeof(int));
+    int depth = 0, i, p;
+
+    for (i = 0; i < numRefs; i++) {
+	for (p = 0; (p < depth) && (stack[p] != refs[i]); p++);
+	if (p == depth) { hist[0]++; depth++; }
+	else hist[p + 1]++;
+	memmove(&stack[1], &stack[0], p * sizeof(int));
+	stack[0] = refs[i];
+    }
+    free(stack);
+}
+
+/* OPT: the same, with the stack ordered by time of next reference.
+ * Going down the stack, each position keeps whichever of its page and
+ * the page pushed down from above is referenced sooner, and passes
+ * the other one on.
+ */
+void
+OptDistances(int *hist)
+{
+    int *stack = (int *) Alloc(numPages * sizeof(int));
+    int *nextUse = (int *) Alloc(numRefs * sizeof(int));
+    int *nextRef = (int *) Alloc(numPages * sizeof(int));
+    int depth = 0, i, p, j, carry, tmp;
+
+    for (i = 0; i < numPages; i++)
+	nextRef[i] = NEVER;
+    for (i = numRefs - 1; i >= 0; i--) {	/* backward pass */
+	nextUse[i] = nextRef[refs[i]];
+	nextRef[refs[i]] = i;
+    }
+    for (i = 0; i < numRefs; i++) {
+	for (p = 0; (p < depth) && (stack[p] != refs[i]); p++);
+	if (p == depth) { hist[0]++; depth++; }
+	else hist[p + 1]++;
+	nextRef[refs[i]] = nextUse[i];
+	if (p == 0) {
+	    stack[0] = refs[i];
+	    continue;
+	}
+	carry = stack[0];
+	stack[0] = refs[i];
+	for (j = 1; j < p; j++)
+	    if (nextRef[stack[j]] > nextRef[carry]) {
+		tmp = stack[j]; stack[j] = carry; carry = tmp;
+	    }
+	stack[p] = carry;
+    }
+    free(stack); free(nextUse); free(nextRef);
+}
+
+/* Faults with n frames, from a stack distance histogram */
+int
+StackFaults(int *hist, int n)
+{
+    int d, faults = hist[0];
+
+    for (d = n + 1; d <= numPages; d++)
+	faults += hist[d];
+    return faults;
+}
+
+#define FIFO	0
+#define CLOCK	1
+#define RANDOM	2
+
+/* Simulate a policy that is not a stack algorithm with n frames */
+int
+Simulate(int policy, int n)
+{
+    int *frameOf = (int *) Alloc(numPages * sizeof(int));
+    int *pageIn = (int *) Alloc(n * sizeof(int));
+    char *refBit = (char *) Alloc(n);
+    int used = 0, hand = 0, faults = 0, i, f;
+
+    for (i = 0; i < numPages; i++)
+	frameOf[i] = -1;
+    srand(1);
+    for (i = 0; i < numRefs; i++) {
+	if (frameOf[refs[i]] != -1) {		/* hit */
+	    refBit[frameOf[refs[i]]] = 1;
+	    continue;
+	}
+	faults++;
+	if (used < n)				/* a free frame */
+	    f = used++;
+	else {
+	    if (policy == FIFO)
+		f = hand;
+	    else if (policy == CLOCK) {
+		while (refBit[hand]) {
+		    refBit[hand] = 0;
+		    hand = (hand + 1) % n;
+		}
+		f = hand;
+	    } else
+		f = rand() % n;
+	    hand = (f + 1) % n;
+	    frameOf[pageIn[f]] = -1;
+	}
+	pageIn[f] = refs[i];
+	frameOf[refs[i]] = f;
+	refBit[f] = 1;
+    }
+    free(frameOf); free(pageIn); free(refBit);
+    return faults;
+}
+
+int
+main(int argc, char **argv)
+{
+    int maxFrames, n, *lruHist, *optHist;
+
+    if ((argc < 2) || (argc > 3)) {
+	fprintf(stderr, "Usage: %s <traceFile> [<maxFrames>]\n", argv[0]);
+	exit(1);
+    }
+    maxFrames = ReadTrace(argv[1]);
+    if (argc == 3)
+	maxFrames = atoi(argv[2]);
+    if (maxFrames < 1) {
+	fprintf(stderr, "Need at least one frame\n");
+	exit(1);
+    }
+
+    lruHist = (int *) Alloc((numPages + 1) * sizeof(int));
+    optHist = (int *) Alloc((numPages + 1) * sizeof(int));
+    memset(lruHist, 0, (numPages + 1) * sizeof(int));
+    memset(optHist, 0, (numPages + 1) * sizeof(int));
+    LruDistances(lruHist);
+    OptDistances(optHist);
+
+    printf("Trace: %d references to %d pages over %d ticks\n",
+			numRefs, numPages, lastTick - firstTick);
+    printf("%6s %9s %9s %9s %9s %9s\n", "Frames", "FIFO", "LRU", "CLOCK",
+						"RANDOM", "OPT");
+    for (n = 1; n <= maxFrames; n++)
+	printf("%6d %9d %9d %9d %9d %9d\n", n, Simulate(FIFO, n),
+		StackFaults(lruHist, n), Simulate(CLOCK, n),
+		Simulate(RANDOM, n), StackFaults(optHist, n));
+    return 0;
+}
@@ -0,0 +1,31 @@
+/* trace.h 
+ *     Data structures defining the page reference trace written by
+ *     "nachos -tr <file>" and read by the replayer.
+ *
+ *     The trace is a header followed by one record per reference to
+ *     a page.  Consecutive references by a process to the page it
+ *     last touched are left out, since they cannot change what any
+ *     replacement policy keeps in memory; a write is kept if the
+ *     previous reference to that page was a read.
+ *
+ *     Both programs run on the same host, so the fields are in host
+ *     byte order.
+ */
+
+#define TRACEMAGIC	0x7ace0001	/* magic number denoting a Nachos
+					 * page reference trace
+					 */
+
+#define TRACE_WRITE	0x8000		/* set in "page" for a store */
+
+typedef struct traceHeader {
+   int traceMagic;		/* should be TRACEMAGIC */
+   int pageSize;		/* bytes per page of the traced machine */
+   int numPhysPages;		/* frames the traced machine had */
+} TraceHeader;
+
+typedef struct traceRecord {
+   int tick;			/* stats->totalTicks at the reference */
+   short pid;			/* process making it */
+   unsigned short page;		/* virtual page number, plus TRACE_WRITE */
+} TraceRecord;
@@ -60,7 +60,8 @@ PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, int param, int time,
 Interrupt::Interrupt()
 {
     level = IntOff;
-    pending = new List();
+    pending = new PendingInterruptList();
+    freeRecords = new PendingInterruptList();
     inHandler = FALSE;
     yieldOnReturn = FALSE;
     status = SystemMode;
@@ -76,6 +77,9 @@ Interrupt::~Interrupt()
     while (!pending->IsEmpty())
 	delete pending->Remove();
     delete pending;
+    while (!freeRecords->IsEmpty())
+	delete freeRecords->Remove();
+    delete freeRecords;
 }
 
 //----------------------------------------------------------------------
@@ -300,7 +304,8 @@ Interrupt::Halt()
 // 	Arrange for the CPU to be interrupted when simulated time
 //	reaches "now + when".
 //
-//	Implementation: just put it on a sorted list.
+//	Implementation: just put it on a sorted list.  The record is
+//	recycled from an earlier interrupt whenever possible.
 //
 //	NOTE: the Nachos kernel should not call this routine directly.
 //	Instead, it is only called by the hardware device simulators.
@@ -315,7 +320,16 @@ void
 Interrupt::Schedule(VoidFunctionPtr handler, int arg, int fromNow, IntType type)
 {
     int when = stats->totalTicks + fromNow;
-    PendingInterrupt *toOccur = new PendingInterrupt(handler, arg, when, type);
+    PendingInterrupt *toOccur = freeRecords->Remove();
+
+    if (toOccur == NULL)
+	toOccur = new PendingInterrupt(handler, arg, when, type);
+    else {
+	toOccur->handler = handler;
+	toOccur->arg = arg;
+	toOccur->when = when;
+	toOccur->type = type;
+    }
 
     DEBUG('i', "Scheduling interrupt handler the %s at time = %d\n", 
 					intTypeNames[type], when);
@@ -347,8 +361,7 @@ Interrupt::CheckIfDue(bool advanceClock)
 					// to invoke an interrupt handler
     if (DebugIsEnabled('i'))
 	DumpState();
-    PendingInterrupt *toOccur = 
-		(PendingInterrupt *)pending->SortedRemove(&when);
+    PendingInterrupt *toOccur = pending->SortedRemove(&when);
 
     if (toOccur == NULL)		// no pending interrupts
 	return FALSE;			
@@ -381,7 +394,7 @@ Interrupt::CheckIfDue(bool advanceClock)
     (*(toOccur->handler))(toOccur->arg);	// call the interrupt handler
     status = old;				// restore the machine status
     inHandler = FALSE;
-    delete toOccur;
+    freeRecords->Prepend(toOccur);
     return TRUE;
 }
 
@@ -67,8 +67,12 @@ class PendingInterrupt {
     int arg;                    // The argument to the function.
     int when;			// When the interrupt is supposed to fire
     IntType type;		// for debugging
+    ListLink<PendingInterrupt> pendingLink;	// Links us into the pending
+				// list, or the list of free records
 };
 
+typedef IntrusiveList<PendingInterrupt, &PendingInterrupt::pendingLink> PendingInterruptList;
+
 // The following class defines the data structures for the simulation
 // of hardware interrupts.  We record whether interrupts are enabled
 // or disabled, and any hardware interrupts that are scheduled to occur
@@ -114,8 +118,10 @@ class Interrupt {
 
   private:
     IntStatus level;		// are interrupts enabled or disabled?
-    List *pending;		// the list of interrupts scheduled
+    PendingInterruptList *pending;	// the list of interrupts scheduled
 				// to occur in the future
+    PendingInterruptList *freeRecords;	// fired interrupts, kept for reuse
+				// so that Schedule need not allocate
     bool inHandler;		// TRUE if we are running an interrupt handler
     bool yieldOnReturn; 	// TRUE if we are to context switch
 				// on return from the interrupt handler
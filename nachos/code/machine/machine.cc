@@ -60,19 +60,32 @@ Machine::Machine(bool debug)
         registers[i] = 0;
     mainMemory = new char[MemorySize];
     physicalPageMap = new PhysicalPageMap[NumPhysPages];
-    fifoQueue = new FifoQueue();
+    for (i = 0; i < NumPhysPages; i++) {
+        physicalPageMap[i].thread_id = -1;
+        physicalPageMap[i].last_access = 0;
+        physicalPageMap[i].refBit = 0;
+        physicalPageMap[i].lastUse = 0;
+        physicalPageMap[i].cleanDoneAt = 0;
+        physicalPageMap[i].refCount = 0;
+        physicalPageMap[i].entry = NULL;
+    }
+    fifoQueue = new PageList(NumPhysPages);
+    lruList = new PageList(NumPhysPages);
+    freeFrames = new int[NumPhysPages];
+    for (i = 0; i < NumPhysPages; i++)		// hand out page 0 first
+        freeFrames[i] = NumPhysPages - 1 - i;
+    numFreeFrames = NumPhysPages;
     for (i = 0; i < MemorySize; i++)
       	mainMemory[i] = 0;
 
-#ifdef USE_TLB
-    tlb = new TranslationEntry[TLBSize];
-    for (i = 0; i < TLBSize; i++)
-	tlb[i].valid = FALSE;
-    NachOSpageTable = NULL;
-#else	// use linear page table
-    tlb = NULL;
+    if (tlbSize > 0) {
+        tlb = new TranslationEntry[tlbSize];
+        for (i = 0; i < tlbSize; i++)
+	    tlb[i].valid = FALSE;
+    }
+    else tlb = NULL;		// use the page table directly
     NachOSpageTable = NULL;
-#endif
+    currentAsid = 0;
 
     singleStep = debug;
     CheckEndian();
@@ -86,6 +99,10 @@ Machine::Machine(bool debug)
 Machine::~Machine()
 {
     delete [] mainMemory;
+    delete [] physicalPageMap;
+    delete [] freeFrames;
+    delete fifoQueue;
+    delete lruList;
     if (tlb != NULL)
         delete [] tlb;
 }
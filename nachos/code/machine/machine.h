@@ -37,6 +37,7 @@
 //#define NumPhysPages    6
 #define MemorySize 	(NumPhysPages * PageSize)
 #define TLBSize		4		// if there is a TLB, make it small
+					// (default size, see -tlb)
 
 enum ExceptionType { NoException,           // Everything ok!
 		     SyscallException,      // A program executed a system call.
@@ -111,56 +112,68 @@ class PhysicalPageMap { // need to implement revrse pagetable
         int thread_id;
         int last_access;
         bool refBit;
-        TranslationEntry *entry;
+        int lastUse;		// Owner's instruction count when the page
+				// was last seen in use (WSCLOCK)
+        int cleanDoneAt;	// When its background write-back completes
+				// (ENHANCED_CLOCK)
+        int refCount;		// # of page tables mapping this frame
+				// (more than one for copy-on-write and
+				// shared memory pages after a fork)
+        TranslationEntry *entry;	// One of the mappers, NULL if none
 };
 
-class FifoElement {		// Needed to implement fifo page replacement algo
-  public:
-    int page;				// page to be removed 
-    FifoElement *next;		// Build the list
-    FifoElement *prev;
+// A list of physical pages, for the FIFO and LRU page replacement
+// algos: in the order they were loaded (FIFO) or last used (LRU).
+// The list is threaded through arrays indexed by page number, so it
+// never allocates, holds each page at most once, and moving a page to
+// the tail (on every memory access, for LRU) or dropping a freed page
+// take constant time.  Evicted pages leave the list until their next
+// user puts them back; shared memory pages, which are never replaced,
+// are kept off it.
 
-    FifoElement(int p) {
-        page = p;
-    }
-};
-
-class FifoQueue {
+class PageList {
   private:
-    FifoElement *first;
-    FifoElement *last;
+    int *next, *prev;		// Neighbours of each page, -1 at the ends
+    bool *queued;		// Is the page on the list?
+    int first, last;		// Oldest (least recently used) and
+				// newest pages
+
   public:
-    FifoQueue() {
-        first = last = NULL;
+    PageList(int n) {
+        next = new int[n];
+        prev = new int[n];
+        queued = new bool[n];
+        for (int i = 0; i < n; i++) queued[i] = FALSE;
+        first = last = -1;
     }
-   ~FifoQueue(void) {}
-
-    void Append(int p) {
-        if (first == NULL) 
-            first = last = new FifoElement(p);
-        else {
-            last->next = new FifoElement(p);
-            last->next->prev = last;
-            last = last->next;
-        }
+   ~PageList(void) { delete [] next; delete [] prev; delete [] queued; }
+
+    void Remove(int p) {		// Drop page p, if queued
+        if (!queued[p]) return;
+        if (prev[p] == -1) first = next[p];
+        else next[prev[p]] = next[p];
+        if (next[p] == -1) last = prev[p];
+        else prev[next[p]] = prev[p];
+        queued[p] = FALSE;
     }
 
-    void Prepend(int p) {
-        if (first == NULL)
-            first = last = new FifoElement(p);
-        else {
-            first->prev = new FifoElement(p);
-            first->prev->next = first;
-            first = first->prev;
-        }
+    void Append(int p) {		// Page p was just loaded (FIFO)
+        if (p == last) return;		// or used (LRU)
+        Remove(p);
+        prev[p] = last;
+        next[p] = -1;
+        if (last == -1) first = p;
+        else next[last] = p;
+        last = p;
+        queued[p] = TRUE;
     }
 
-    int Remove() {
-        FifoElement *temp = first;
-        int i = temp->page;
-        first = first->next;
-        delete temp;
-        return i;
+    int Victim(bool (*evictable)(int p, int avoid), int avoid) {
+        int p = first;			// Oldest page that may be replaced;
+        while ((p != -1) && !(*evictable)(p, avoid))	// it stays queued
+            p = next[p];		// until evicted
+        ASSERT(p != -1);
+        return p;
     }
 };
 
@@ -220,7 +233,10 @@ class Machine {
 				// code and data, while executing
  
     PhysicalPageMap *physicalPageMap; // Inverse page table
-    FifoQueue *fifoQueue; 
+    PageList *fifoQueue; 
+    PageList *lruList;
+    int *freeFrames;		// Stack of physical pages not mapped by
+    int numFreeFrames;		// any process
     int registers[NumTotalRegs]; // CPU registers, for executing user programs
 
 
@@ -235,6 +251,7 @@ class Machine {
 // If "tlb" is non-NULL, the Nachos kernel is responsible for managing
 //	the contents of the TLB.  But the kernel can use any data structure
 //	it wants (eg, segmented paging) for handling TLB cache misses.
+//	TLB entries only match while "currentAsid" holds their asid.
 // 
 // For simplicity, both the page table pointer and the TLB pointer are
 // public.  However, while there can be multiple page tables (one per address
@@ -245,8 +262,9 @@ class Machine {
     TranslationEntry *tlb;		// this pointer should be considered 
 					// "read-only" to Nachos kernel code
 
-    TranslationEntry *NachOSpageTable;
-    unsigned int NachOSpageTableSize;
+    PageTable *NachOSpageTable;
+    int currentAsid;			// Address space of the running
+					// process, for matching TLB entries
 
   private:
     bool singleStep;		// drop back into the debugger after each
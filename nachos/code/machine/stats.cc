@@ -22,6 +22,20 @@ Statistics::Statistics()
     numDiskReads = numDiskWrites = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numTLBHits = numTLBMisses = 0;
+    numCowFaults = numCowCopies = 0;
+    numTextPageHits = numZeroFillFaults = 0;
+    numMappedPagesRead = numMappedPageHits = numMappedPagesWritten = 0;
+    numPagesPrefetched = numPrefetchHits = numPrefetchWasted = 0;
+    numPrepageBatches = numPagesPrepaged = numPrepageHits = numPrepageWasted = 0;
+    numSwapIns = numSwapOuts = swapInTicks = swapOutTicks = 0;
+    numPageIOWaits = pageIOWaitTicks = 0;
+    numZpoolStores = numZpoolSameFilled = numZpoolRejects = 0;
+    numZpoolHits = numZpoolSpills = 0;
+    zpoolBytesIn = zpoolBytesStored = 0;
+    numDeactivations = numPagesReleased = 0;
+    numPagesCleaned = numPagesCleanedAsync = 0;
+    numPagesScanned = numPagesMerged = 0;
     
     total_wait_time = 0;
     cpu_time = 0;
@@ -34,6 +48,8 @@ Statistics::Statistics()
     nonpreemptive_switch = 0;
 
     burstEstimateError = 0;
+
+    numPriorityInversions = priorityInversionTime = 0;
 }
 
 //----------------------------------------------------------------------
@@ -50,7 +66,31 @@ Statistics::Print()
     printf("Disk I/O: reads %d, writes %d\n", numDiskReads, numDiskWrites);
     printf("Console I/O: reads %d, writes %d\n", numConsoleCharsRead, 
 	numConsoleCharsWritten);
-    printf("Paging: faults %d\n", numPageFaults);
+    printf("TLB: hits %d, misses %d, hit rate %.2f%%\n", numTLBHits, numTLBMisses,
+	(numTLBHits + numTLBMisses) ? 100.0 * numTLBHits / (numTLBHits + numTLBMisses) : 0.0);
+    printf("Paging: faults %d, text page cache hits %d, zero-filled %d\n", numPageFaults,
+	numTextPageHits, numZeroFillFaults);
+    printf("Mapped files: pages read %d, shared %d, written back %d\n",
+	numMappedPagesRead, numMappedPageHits, numMappedPagesWritten);
+    printf("Prefetch: pages %d, hits %d, wasted %d\n", numPagesPrefetched,
+	numPrefetchHits, numPrefetchWasted);
+    printf("Prepaging: batches %d, pages %d, faults saved %d, wasted %d\n",
+	numPrepageBatches, numPagesPrepaged, numPrepageHits, numPrepageWasted);
+    printf("Copy-on-write: faults %d, pages copied %d\n", numCowFaults, numCowCopies);
+    printf("Swap: pages in %d, out %d, average latency in %d, out %d\n",
+	numSwapIns, numSwapOuts, numSwapIns ? swapInTicks/numSwapIns : 0,
+	numSwapOuts ? swapOutTicks/numSwapOuts : 0);
+    printf("Paging I/O: waits %d, average wait %d\n", numPageIOWaits,
+	numPageIOWaits ? pageIOWaitTicks/numPageIOWaits : 0);
+    printf("Compressed pool: pages stored %d (same-filled %d), rejected %d, hits %d, spilled %d, ratio %.2f\n",
+	numZpoolStores, numZpoolSameFilled, numZpoolRejects, numZpoolHits, numZpoolSpills,
+	zpoolBytesStored ? (double)zpoolBytesIn / zpoolBytesStored : 0.0);
+    printf("Load control: deactivations %d, pages released %d\n",
+	numDeactivations, numPagesReleased);
+    printf("Pageout daemon: pages freed %d\n", numPagesCleaned);
+    printf("Background write-back: pages %d\n", numPagesCleanedAsync);
+    printf("Page merging: pages scanned %d, frames saved %d\n", numPagesScanned,
+	numPagesMerged);
     printf("Network I/O: packets received %d, sent %d\n", numPacketsRecvd, 
 	numPacketsSent);
 
@@ -59,5 +99,6 @@ Statistics::Print()
     printf("Non-zero CPU burst statistics: count: %d, max: %d, min: %d, mean: %.2f\n", cpu_burst_count, max_cpu_burst, min_cpu_burst, (float)cpu_time/cpu_burst_count);
     printf("Number of context switches through yield or preemption: %d, Number of non-preemptive context switches: %d\n", preemptive_switch, nonpreemptive_switch);
     printf("Total time for which the ready queue is empty: %d\n", empty_ready_queue_time);
-    printf("Wait time in ready queue: Total: %d, Average: %.2f\n\n", total_wait_time, (float)total_wait_time/numTotalThreads);
+    printf("Wait time in ready queue: Total: %d, Average: %.2f\n", total_wait_time, (float)total_wait_time/numTotalThreads);
+    printf("Priority inversions: count: %d, blocked time: %d\n\n", numPriorityInversions, priorityInversionTime);
 }
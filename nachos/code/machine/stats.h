@@ -43,11 +43,53 @@ class Statistics {
 
     int burstEstimateError;	// Keeps track of the squared error in burst estimates
 
+    int numPriorityInversions;	// Waits in P() that had to lend priority to the holder
+    int priorityInversionTime;	// Total ticks spent blocked in such waits
+
     int numDiskReads;		// number of disk read requests
     int numDiskWrites;		// number of disk write requests
     int numConsoleCharsRead;	// number of characters read from the keyboard
     int numConsoleCharsWritten; // number of characters written to the display
     int numPageFaults;		// number of virtual memory page faults
+    int numTLBHits;		// translations found in the TLB
+    int numTLBMisses;		// TLB refills from the page table
+    int numTextPageHits;	// faults satisfied from the text page cache
+    int numZeroFillFaults;	// faults on bss and stack pages, zeroed in place
+    int numMappedPagesRead;	// pages of mapped files read in
+    int numMappedPageHits;	// faults on them found in another process
+    int numMappedPagesWritten;	// dirty pages of mapped files written back
+    int numPagesPrefetched;	// pages brought in by clustering and read-ahead
+    int numPrefetchHits;	// of those, pages later used
+    int numPrefetchWasted;	// of those, pages dropped without being used
+    int numPrepageBatches;	// faults that brought back a working set
+    int numPagesPrepaged;	// pages brought back that way (also counted
+				// as prefetched)
+    int numPrepageHits;		// of those, pages later used: faults saved
+    int numPrepageWasted;	// of those, pages dropped without being used
+    int numCowFaults;		// number of writes to copy-on-write pages
+    int numCowCopies;		// number of those that had to copy the frame
+    int numSwapIns;		// number of pages read from the swap area
+    int numSwapOuts;		// number of pages written to the swap area
+    int swapInTicks;		// total latency of those reads
+    int swapOutTicks;		// total latency of those writes
+    int numPageIOWaits;		// faults that blocked for paging I/O
+    int pageIOWaitTicks;	// time they blocked for the disk, queueing
+				// included
+    int numZpoolStores;		// pages swapped out to the compressed pool
+    int numZpoolSameFilled;	// of those, pages of one repeated word
+    int numZpoolRejects;	// pages that did not compress well enough
+    int numZpoolHits;		// pages swapped in from the pool
+    int numZpoolSpills;		// pages moved from the pool to the swap file
+    int zpoolBytesIn;		// size of the pages stored
+    int zpoolBytesStored;	// their compressed size
+    int numDeactivations;	// processes taken off memory by load control
+    int numPagesReleased;	// pages given up by PFF and load control
+    int numPagesCleaned;	// pages freed ahead of demand by the pageout daemon
+    int numPagesCleanedAsync;	// dirty pages written back in the background
+				// by the enhanced clock
+    int numPagesScanned;	// frames hashed by the page merger
+    int numPagesMerged;		// frames it freed by merging them into
+				// identical ones
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
 
@@ -35,6 +35,7 @@ extern "C" {
 #include <sys/file.h>
 #include <sys/un.h>
 #include <sys/mman.h>
+#include <time.h>
 #ifdef HOST_i386
 #include <sys/time.h>
 #endif
@@ -407,6 +408,31 @@ Delay(int seconds)
     (void) sleep((unsigned) seconds);
 }
 
+//----------------------------------------------------------------------
+// HostNanoseconds
+// 	Return the host's wall clock time in nanoseconds, from an
+//	arbitrary origin.  Only differences are meaningful.  Used to
+//	time kernel code paths, as opposed to the simulated time in
+//	"stats".  Resolution is a microsecond on hosts without a
+//	monotonic clock.
+//----------------------------------------------------------------------
+
+double
+HostNanoseconds()
+{
+#ifdef CLOCK_MONOTONIC
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+#else
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1e9 + tv.tv_usec * 1e3;
+#endif
+}
+
 //----------------------------------------------------------------------
 // Abort
 // 	Quit and drop core.
@@ -6,8 +6,9 @@
 //
 // Two types of translation are supported here.
 //
-//	Linear page table -- the virtual page # is used as an index
-//	into the table, to find the physical page #.
+//	Two-level page table -- the virtual page # is split into an
+//	index into a directory of leaves and an index into the leaf,
+//	to find the physical page #.
 //
 //	Translation lookaside buffer -- associative lookup in the table
 //	to find an entry with the same virtual page #.  If found,
@@ -168,6 +169,84 @@ Machine::WriteMem(int addr, int size, int value)
     return TRUE;
 }
 
+//----------------------------------------------------------------------
+// PageTable::PageTable
+// 	Create an empty page table for virtual pages [0, "size").
+//----------------------------------------------------------------------
+
+PageTable::PageTable(unsigned size)
+{
+    unsigned numLeaves = divRoundUp(size, PageTableLeafSize);
+
+    numPages = size;
+    dir = new TranslationEntry*[numLeaves];
+    for (unsigned i = 0; i < numLeaves; i++)
+        dir[i] = NULL;
+}
+
+//----------------------------------------------------------------------
+// PageTable::~PageTable
+//----------------------------------------------------------------------
+
+PageTable::~PageTable()
+{
+    for (unsigned i = 0; i < divRoundUp(numPages, PageTableLeafSize); i++)
+        if (dir[i] != NULL) delete [] dir[i];
+    delete [] dir;
+}
+
+//----------------------------------------------------------------------
+// PageTable::Entry
+// 	Return the entry for "vpn", allocating its leaf if this is the
+//	first use of any page in it.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+PageTable::Entry(unsigned vpn)
+{
+    TranslationEntry *leaf;
+    unsigned i, first = vpn - vpn % PageTableLeafSize;
+
+    ASSERT(vpn < numPages);
+    if (dir[vpn / PageTableLeafSize] == NULL) {
+        leaf = new TranslationEntry[PageTableLeafSize];
+        for (i = 0; i < PageTableLeafSize; i++) {
+            leaf[i].virtualPage = first + i;
+            leaf[i].physicalPage = -1;
+            leaf[i].valid = FALSE;
+            leaf[i].readOnly = FALSE;
+            leaf[i].use = FALSE;
+            leaf[i].dirty = FALSE;
+            leaf[i].shared = FALSE;
+            leaf[i].swapSlot = -1;
+            leaf[i].prefetched = FALSE;
+            leaf[i].prepaged = FALSE;
+            leaf[i].cow = FALSE;
+            leaf[i].mapped = FALSE;
+            leaf[i].asid = 0;
+        }
+        dir[vpn / PageTableLeafSize] = leaf;
+    }
+    return Lookup(vpn);
+}
+
+//----------------------------------------------------------------------
+// PageTable::Next
+// 	Return the first entry at or after virtual page "*vpn" whose leaf
+//	exists, and set "*vpn" to its page; NULL if there is none.  Lets
+//	a walk over the table skip the unused parts of the address space:
+//
+//	    for (vpn = 0; (entry = table->Next(&vpn)) != NULL; vpn++)
+//----------------------------------------------------------------------
+
+TranslationEntry *
+PageTable::Next(unsigned *vpn)
+{
+    while ((*vpn < numPages) && (dir[*vpn / PageTableLeafSize] == NULL))
+        *vpn += PageTableLeafSize - *vpn % PageTableLeafSize;
+    return Lookup(*vpn);
+}
+
 //----------------------------------------------------------------------
 // Machine::Translate
 // 	Translate a virtual address into a physical address, using 
@@ -199,8 +278,8 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 	return AddressErrorException;
     }
     
-    // we must have either a TLB or a page table, but not both!
-    ASSERT(tlb == NULL || NachOSpageTable == NULL);	
+    // we must have either a TLB or a page table; with a TLB, the page
+    // table is only used by the kernel to refill it
     ASSERT(tlb != NULL || NachOSpageTable != NULL);	
 
 // calculate the virtual page number, and offset within the page,
@@ -209,19 +288,21 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
     offset = (unsigned) virtAddr % PageSize;
     
     if (tlb == NULL) {		// => page table => vpn is index into table
-	if (vpn >= NachOSpageTableSize) {
+	if (vpn >= NachOSpageTable->NumPages()) {
 	    DEBUG('a', "virtual page # %d too large for page table size %d!\n", 
-			virtAddr, NachOSpageTableSize);
+			virtAddr, NachOSpageTable->NumPages());
 	    return AddressErrorException;
-	} else if (!NachOSpageTable[vpn].valid) {
+	}
+	entry = NachOSpageTable->Lookup(vpn);
+	if ((entry == NULL) || !entry->valid) {
 	    DEBUG('a', "Page Fault at %d\n",
 			virtAddr);
 	    return PageFaultException;
 	}
-	entry = &NachOSpageTable[vpn];
     } else {
-        for (entry = NULL, i = 0; i < TLBSize; i++)
-    	    if (tlb[i].valid && (tlb[i].virtualPage == vpn)) {
+        for (entry = NULL, i = 0; i < tlbSize; i++)
+    	    if (tlb[i].valid && (tlb[i].virtualPage == (int)vpn)
+                        && (tlb[i].asid == currentAsid)) {
 		entry = &tlb[i];			// FOUND!
 		break;
 	    }
@@ -231,6 +312,8 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 						// the page may be in memory,
 						// but not in the TLB
 	}
+	stats->numTLBHits++;
+	tlbManager->Touch(i);
     }
 
     if (entry->readOnly && writing) {	// trying to write to a read-only page
@@ -247,10 +330,19 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
     }
     machine->physicalPageMap[pageFrame].last_access = stats->totalTicks;
     machine->physicalPageMap[pageFrame].refBit = 1;
+    if ((pageReplacementAlgo == LRU) && !entry->shared)
+        machine->lruList->Append(pageFrame);
 
+    if (entry->prefetched) {	// the read-ahead paid off
+        if (entry->prepaged) stats->numPrepageHits++;
+        entry->prefetched = entry->prepaged = FALSE;
+        stats->numPrefetchHits++;
+    }
     entry->use = TRUE;		// set the use, dirty bits
     if (writing)
 	entry->dirty = TRUE;
+    if (pageTrace != NULL)
+        pageTrace->Record(currentThread->GetPID(), vpn, writing);
     *physAddr = pageFrame * PageSize + offset;
     ASSERT((*physAddr >= 0) && ((*physAddr + size) <= MemorySize));
     DEBUG('a', "phys addr = 0x%x\n", *physAddr);
@@ -273,8 +365,8 @@ Machine::GetPA (unsigned vaddr)
    TranslationEntry *entry;
    unsigned int pageFrame;
 
-   if ((vpn < NachOSpageTableSize) && NachOSpageTable[vpn].valid) {
-      entry = &NachOSpageTable[vpn];
+   entry = NachOSpageTable->Lookup(vpn);
+   if ((entry != NULL) && entry->valid) {
       pageFrame = entry->physicalPage;
       if (pageFrame >= NumPhysPages) return -1;
       return pageFrame * PageSize + offset;
@@ -41,8 +41,49 @@ class TranslationEntry {
     bool dirty;         // This bit is set by the hardware every time the
 			// page is modified.
     bool shared;        // This page is shared with other process
-    bool backup;        // Indicates if the page is saved in backup array
+    int swapSlot;       // Swap area slot holding a copy of the page,
+			// -1 if none
+    bool prefetched;    // Brought in ahead of demand, not used yet
+    bool prepaged;      // Of those, brought back with the working set
+    bool cow;           // Frame shared copy-on-write with other processes
+			// since a fork; readOnly is set until the first write
+    bool mapped;        // Backed by a file mapped with SYScall_Mmap, even
+			// while not valid
+    int asid;           // TLB only: the address space the entry belongs
+			// to, matched against Machine::currentAsid
 
 };
 
+// A two-level page table.  The virtual page number is split into an
+// index into a directory, and an index into a leaf of PageTableLeafSize
+// entries.  A leaf is allocated, with all its entries invalid, the first
+// time one of them is needed; parts of the address space that are never
+// used cost a NULL directory slot.  Leaves never move, so pointers to
+// entries stay good as long as the table exists.
+
+#define PageTableLeafSize	16	// Entries per leaf
+
+class PageTable {
+  public:
+    PageTable(unsigned size);		// Cover virtual pages [0, size),
+					// with no leaves yet
+    ~PageTable();
+
+    unsigned NumPages() { return numPages; }
+
+    TranslationEntry *Lookup(unsigned vpn) {	// NULL if vpn is out of
+        TranslationEntry *leaf;			// range or has no leaf
+        if (vpn >= numPages) return NULL;
+        leaf = dir[vpn / PageTableLeafSize];
+        return (leaf == NULL) ? NULL : &leaf[vpn % PageTableLeafSize];
+    }
+    TranslationEntry *Entry(unsigned vpn);	// Same, allocating the leaf
+    TranslationEntry *Next(unsigned *vpn);	// First entry at or after *vpn
+						// that has a leaf, NULL if none
+
+  private:
+    TranslationEntry **dir;		// Leaf for each group of pages
+    unsigned numPages;
+};
+
 #endif
@@ -0,0 +1,55 @@
+#include "syscall.h"
+#include "synchop.h"
+
+#define NUM_WORKERS 4
+#define SIZE 100
+#define ROUNDS 3
+
+int
+main()
+{
+    /* partial[NUM_WORKERS], total */
+    int *shared = (int*)system_call_ShmAllocate((NUM_WORKERS+1)*sizeof(int));
+    int bar = system_call_BarrierGet(1, NUM_WORKERS);
+    int rw = system_call_RWLockGet(1, 1);
+    int id, x, i, r, sum;
+
+    shared[NUM_WORKERS] = 0;
+    for (id=1; id<NUM_WORKERS; id++) {
+       x = system_call_Fork();
+       if (x == 0) break;
+    }
+    if (id == NUM_WORKERS) id = 0;	/* the parent is worker 0 */
+
+    for (r=0; r<ROUNDS; r++) {
+       sum = 0;
+       for (i=id; i<SIZE; i+=NUM_WORKERS) sum += i;
+       shared[id] = sum;
+       system_call_BarrierWait(bar);	/* all partial sums are in */
+
+       if (id == 0) {
+          system_call_RWLockOp(rw, RWLOCK_OP_WRITE_ACQUIRE);
+          for (i=0; i<NUM_WORKERS; i++) shared[NUM_WORKERS] += shared[i];
+          system_call_RWLockOp(rw, RWLOCK_OP_WRITE_RELEASE);
+       }
+       system_call_BarrierWait(bar);	/* the total is in */
+
+       system_call_RWLockOp(rw, RWLOCK_OP_READ_ACQUIRE);
+       if (shared[NUM_WORKERS] != (r+1)*(SIZE*(SIZE-1)/2)) {
+          system_call_PrintString("Worker ");
+          system_call_PrintInt(id);
+          system_call_PrintString(" saw a wrong total\n");
+       }
+       system_call_RWLockOp(rw, RWLOCK_OP_READ_RELEASE);
+       system_call_BarrierWait(bar);	/* everybody has read it */
+    }
+
+    if (id == 0) {
+       system_call_PrintString("Total after ");
+       system_call_PrintInt(ROUNDS);
+       system_call_PrintString(" rounds: ");
+       system_call_PrintInt(shared[NUM_WORKERS]);
+       system_call_PrintChar('\n');
+    }
+    return 0;
+}
@@ -0,0 +1,52 @@
+#include "syscall.h"
+#include "ulock.h"
+
+#define NUM_CHILDREN 4
+#define NUM_ITER 200
+
+typedef struct {
+   UserMutex mutex;
+   UserCond done;
+   int count;
+   int finished;
+} Shared;
+
+int
+main()
+{
+    Shared *s = (Shared*)system_call_ShmAllocate(sizeof(Shared));
+    int x, i, k;
+
+    UserLockInit();
+    UserMutexInit(&s->mutex);
+    UserCondInit(&s->done);
+    s->count = 0;
+    s->finished = 0;
+
+    for (k=0; k<NUM_CHILDREN; k++) {
+       x = system_call_Fork();
+       if (x == 0) {
+          for (i=0; i<NUM_ITER; i++) {
+             UserMutexLock(&s->mutex);
+             s->count++;
+             UserMutexUnlock(&s->mutex);
+          }
+          UserMutexLock(&s->mutex);
+          s->finished++;
+          UserCondSignal(&s->done);
+          UserMutexUnlock(&s->mutex);
+          return 0;
+       }
+    }
+
+    UserMutexLock(&s->mutex);
+    while (s->finished < NUM_CHILDREN) UserCondWait(&s->done, &s->mutex);
+    UserMutexUnlock(&s->mutex);
+
+    system_call_PrintString("Count=");
+    system_call_PrintInt(s->count);
+    system_call_PrintString(" (expected ");
+    system_call_PrintInt(NUM_CHILDREN*NUM_ITER);
+    system_call_PrintString(")\n");
+    return 0;
+}
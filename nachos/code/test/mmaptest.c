@@ -0,0 +1,25 @@
+#include "syscall.h"
+
+#define LENGTH 4096	/* bytes past the end of the file read as 0 */
+
+int
+main()
+{
+    char *text = (char*)system_call_Mmap("../test/matmult.c", LENGTH);
+    int lines = 0, i;
+
+    if (text == (char*)-1) {
+       system_call_PrintString("Mmap failed\n");
+       return 1;
+    }
+    for (i=0; (i<LENGTH) && (text[i] != '\0'); i++) {
+       if (text[i] == '\n') lines++;
+    }
+    system_call_PrintString("Lines in matmult.c: ");
+    system_call_PrintInt(lines);
+    system_call_PrintChar('\n');
+    system_call_PrintString("Munmap returned ");
+    system_call_PrintInt(system_call_Munmap(text));
+    system_call_PrintChar('\n');
+    return 0;
+}
@@ -0,0 +1,30 @@
+#include "syscall.h"
+
+#define KEY	42
+#define SIZE	16
+
+int
+main()
+{
+    int shmid = system_call_ShmGet(KEY, (SIZE+1)*sizeof(int));
+    int *array = (int*)system_call_ShmAttach(shmid, 0);
+    int x, i;
+
+    for (i=0; i<SIZE; i++) array[i] = i;
+    array[SIZE] = -1;
+
+    x = system_call_Fork();
+    if (x == 0) {
+       system_call_Exec("../test/shmpeer");	// attaches the segment by key
+    }
+    else {
+       x = system_call_Join(x);
+       system_call_PrintString("Sum computed by peer=");
+       system_call_PrintInt(array[SIZE]);
+       system_call_PrintChar('\n');
+       system_call_PrintString("Detach returned ");
+       system_call_PrintInt(system_call_ShmDetach(array));
+       system_call_PrintChar('\n');
+    }
+    return 0;
+}
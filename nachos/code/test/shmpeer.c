@@ -0,0 +1,17 @@
+#include "syscall.h"
+
+#define KEY	42
+#define SIZE	16
+
+int
+main()
+{
+    int shmid = system_call_ShmGet(KEY, (SIZE+1)*sizeof(int));
+    int *array = (int*)system_call_ShmAttach(shmid, 0);
+    int sum = 0, i;
+
+    for (i=0; i<SIZE; i++) sum += array[i];
+    array[SIZE] = sum;
+    system_call_ShmDetach(array);
+    return 0;
+}
@@ -274,6 +274,130 @@ system_call_ShmAllocate:
         j       $31
         .end system_call_ShmAllocate
 
+        .globl system_call_FutexWait
+        .ent    system_call_FutexWait
+system_call_FutexWait:
+	addiu $2,$0,SYScall_FutexWait
+        syscall
+        j       $31
+        .end system_call_FutexWait
+
+        .globl system_call_FutexWake
+        .ent    system_call_FutexWake
+system_call_FutexWake:
+	addiu $2,$0,SYScall_FutexWake
+        syscall
+        j       $31
+        .end system_call_FutexWake
+
+        .globl system_call_RasCtl
+        .ent    system_call_RasCtl
+system_call_RasCtl:
+	addiu $2,$0,SYScall_RasCtl
+        syscall
+        j       $31
+        .end system_call_RasCtl
+
+        .globl system_call_BarrierGet
+        .ent    system_call_BarrierGet
+system_call_BarrierGet:
+	addiu $2,$0,SYScall_BarrierGet
+        syscall
+        j       $31
+        .end system_call_BarrierGet
+
+        .globl system_call_BarrierWait
+        .ent    system_call_BarrierWait
+system_call_BarrierWait:
+	addiu $2,$0,SYScall_BarrierWait
+        syscall
+        j       $31
+        .end system_call_BarrierWait
+
+        .globl system_call_RWLockGet
+        .ent    system_call_RWLockGet
+system_call_RWLockGet:
+	addiu $2,$0,SYScall_RWLockGet
+        syscall
+        j       $31
+        .end system_call_RWLockGet
+
+        .globl system_call_RWLockOp
+        .ent    system_call_RWLockOp
+system_call_RWLockOp:
+	addiu $2,$0,SYScall_RWLockOp
+        syscall
+        j       $31
+        .end system_call_RWLockOp
+
+        .globl system_call_ShmGet
+        .ent    system_call_ShmGet
+system_call_ShmGet:
+	addiu $2,$0,SYScall_ShmGet
+        syscall
+        j       $31
+        .end system_call_ShmGet
+
+        .globl system_call_ShmAttach
+        .ent    system_call_ShmAttach
+system_call_ShmAttach:
+	addiu $2,$0,SYScall_ShmAttach
+        syscall
+        j       $31
+        .end system_call_ShmAttach
+
+        .globl system_call_ShmDetach
+        .ent    system_call_ShmDetach
+system_call_ShmDetach:
+	addiu $2,$0,SYScall_ShmDetach
+        syscall
+        j       $31
+        .end system_call_ShmDetach
+
+        .globl system_call_Mmap
+        .ent    system_call_Mmap
+system_call_Mmap:
+	addiu $2,$0,SYScall_Mmap
+        syscall
+        j       $31
+        .end system_call_Mmap
+
+        .globl system_call_Munmap
+        .ent    system_call_Munmap
+system_call_Munmap:
+	addiu $2,$0,SYScall_Munmap
+        syscall
+        j       $31
+        .end system_call_Munmap
+
+/* -------------------------------------------------------------
+ * AtomicCompareAndSwap (int *addr, int old, int new)
+ *	Store new into *addr if *addr equals old; return the value
+ *	*addr held.  The load-compare-store between AtomicSeqStart and
+ *	AtomicSeqEnd must be registered with system_call_RasCtl: the
+ *	kernel restarts it from the top if the thread is switched out
+ *	midway, which makes it atomic on our uniprocessor.
+ * -------------------------------------------------------------
+ */
+
+	.globl AtomicCompareAndSwap
+	.ent	AtomicCompareAndSwap
+AtomicCompareAndSwap:
+	.set	noreorder
+	.globl	AtomicSeqStart
+AtomicSeqStart:
+	lw	$2,0($4)
+	nop
+	bne	$2,$5,1f
+	nop
+	sw	$6,0($4)
+	.globl	AtomicSeqEnd
+AtomicSeqEnd:
+1:	j	$31
+	nop
+	.set	reorder
+	.end AtomicCompareAndSwap
+
 /* dummy function to keep gcc happy */
         .globl  __main
         .ent    __main
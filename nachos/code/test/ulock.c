@@ -0,0 +1,99 @@
+/* ulock.c
+ *	User level mutexes and condition variables built on futexes.
+ *	The mutex follows the three state design of Drepper's "Futexes
+ *	Are Tricky": a waiter always leaves the word in the contended state,
+ *	so an unlock that finds it contended knows it has to wake somebody.
+ */
+
+#include "syscall.h"
+#include "ulock.h"
+
+#define MAX_WAKE	0x7fffffff
+
+extern char AtomicSeqStart[], AtomicSeqEnd[];
+
+static int
+AtomicExchange (int *addr, int new)
+{
+   int old;
+
+   do {
+      old = *addr;
+   } while (AtomicCompareAndSwap(addr, old, new) != old);
+   return old;
+}
+
+static void
+AtomicIncrement (int *addr)
+{
+   int old;
+
+   do {
+      old = *addr;
+   } while (AtomicCompareAndSwap(addr, old, old+1) != old);
+}
+
+void
+UserLockInit (void)
+{
+   system_call_RasCtl(AtomicSeqStart, AtomicSeqEnd - AtomicSeqStart);
+}
+
+void
+UserMutexInit (UserMutex *m)
+{
+   m->state = UMUTEX_FREE;
+}
+
+void
+UserMutexLock (UserMutex *m)
+{
+   int c = AtomicCompareAndSwap(&m->state, UMUTEX_FREE, UMUTEX_LOCKED);
+
+   if (c == UMUTEX_FREE) return;		/* fast path, no syscall */
+   if (c != UMUTEX_CONTENDED) c = AtomicExchange(&m->state, UMUTEX_CONTENDED);
+   while (c != UMUTEX_FREE) {
+      system_call_FutexWait(&m->state, UMUTEX_CONTENDED);
+      c = AtomicExchange(&m->state, UMUTEX_CONTENDED);
+   }
+}
+
+void
+UserMutexUnlock (UserMutex *m)
+{
+   if (AtomicExchange(&m->state, UMUTEX_FREE) == UMUTEX_CONTENDED)
+      system_call_FutexWake(&m->state, 1);
+}
+
+void
+UserCondInit (UserCond *c)
+{
+   c->seq = 0;
+}
+
+void
+UserCondWait (UserCond *c, UserMutex *m)
+{
+   int seq = c->seq;
+
+   UserMutexUnlock(m);
+   system_call_FutexWait(&c->seq, seq);	/* returns at once if signalled
+					   since we sampled seq */
+   /* We cannot tell whether others are waiting, so assume they are. */
+   while (AtomicExchange(&m->state, UMUTEX_CONTENDED) != UMUTEX_FREE)
+      system_call_FutexWait(&m->state, UMUTEX_CONTENDED);
+}
+
+void
+UserCondSignal (UserCond *c)
+{
+   AtomicIncrement(&c->seq);
+   system_call_FutexWake(&c->seq, 1);
+}
+
+void
+UserCondBroadcast (UserCond *c)
+{
+   AtomicIncrement(&c->seq);
+   system_call_FutexWake(&c->seq, MAX_WAKE);
+}
@@ -0,0 +1,43 @@
+/* ulock.h
+ *	User level mutexes and condition variables built on futexes.
+ *
+ *	The lock word lives in shared memory (system_call_ShmAllocate) and
+ *	is manipulated with AtomicCompareAndSwap from start.s.  Locking and
+ *	unlocking an uncontended mutex never enters the kernel; a thread
+ *	only calls system_call_FutexWait when the mutex is held, and the
+ *	owner only calls system_call_FutexWake when somebody is waiting.
+ *
+ *	UserLockInit must be called once by a process before it uses any
+ *	of the other routines (forked children inherit the registration).
+ */
+
+#ifndef ULOCK_H
+#define ULOCK_H
+
+/* Mutex states */
+#define UMUTEX_FREE		0
+#define UMUTEX_LOCKED		1	/* held, nobody waiting */
+#define UMUTEX_CONTENDED	2	/* held, maybe somebody waiting */
+
+typedef struct {
+   int state;
+} UserMutex;
+
+typedef struct {
+   int seq;			/* bumped by every signal/broadcast */
+} UserCond;
+
+int AtomicCompareAndSwap (int *addr, int old, int new);
+
+void UserLockInit (void);
+
+void UserMutexInit (UserMutex *m);
+void UserMutexLock (UserMutex *m);
+void UserMutexUnlock (UserMutex *m);
+
+void UserCondInit (UserCond *c);
+void UserCondWait (UserCond *c, UserMutex *m);
+void UserCondSignal (UserCond *c);
+void UserCondBroadcast (UserCond *c);
+
+#endif /* ULOCK_H */
@@ -58,11 +58,150 @@ class List {
     void SortedInsert(void *item, int sortKey);	// Put item into list
     void *SortedRemove(int *keyPtr); 	  	// Remove first item from list
 
-    void *GetMinPriorityThread (void);
-
   private:
     ListElement *first;  	// Head of the list, NULL if list is empty
     ListElement *last;		// Last element of list
 };
 
+// The following templates define an "intrusive" list, with the same
+// operations and FIFO/sorted semantics as List, for the kernel queues
+// that are touched on every context switch (the ready list, semaphore
+// wait queues, the pending interrupt list).  Instead of allocating a
+// ListElement per item, the item itself carries the link:
+//
+//	class Foo { ... ListLink<Foo> link; ... };
+//	IntrusiveList<Foo, &Foo::link> fooList;
+//
+// so that putting an item on the list never allocates memory.  The
+// price is that an item can be on at most one list per embedded link
+// at a time.  The code is in the header because it is a template.
+
+template <class T>
+class ListLink {
+  public:
+    ListLink() { next = NULL; key = 0; }
+
+    T *next;			// next item on the list, NULL if the last
+    int key;			// priority, for a sorted list
+};
+
+template <class T, ListLink<T> T::*link>
+class IntrusiveList {
+  public:
+    IntrusiveList() { first = last = NULL; }	// initialize the list
+    ~IntrusiveList() {}			// items are not ours to delete
+
+    void Prepend(T *item);		// Put item at the beginning of the list
+    void Append(T *item);		// Put item at the end of the list
+    T *Remove() { return SortedRemove(NULL); }	// Take item off the front
+
+    void Mapcar(VoidFunctionPtr func);	// Apply "func" to every item
+    bool IsEmpty() { return (first == NULL); }
+
+    void SortedInsert(T *item, int sortKey);	// Put item into list
+    T *SortedRemove(int *keyPtr);		// Remove first item from list
+
+    T *RemoveMin(int (T::*keyOf)(void));	// Remove the first item with
+						// the smallest item->keyOf()
+
+  private:
+    T *first;			// Head of the list, NULL if list is empty
+    T *last;			// Last item on the list
+};
+
+template <class T, ListLink<T> T::*link>
+void
+IntrusiveList<T, link>::Append(T *item)
+{
+    ASSERT(((item->*link).next == NULL) && (item != last));	// not on a list
+    if (IsEmpty()) first = item;
+    else (last->*link).next = item;
+    last = item;
+}
+
+template <class T, ListLink<T> T::*link>
+void
+IntrusiveList<T, link>::Prepend(T *item)
+{
+    ASSERT(((item->*link).next == NULL) && (item != last));
+    if (IsEmpty()) last = item;
+    else (item->*link).next = first;
+    first = item;
+}
+
+template <class T, ListLink<T> T::*link>
+void
+IntrusiveList<T, link>::Mapcar(VoidFunctionPtr func)
+{
+    for (T *ptr = first; ptr != NULL; ptr = (ptr->*link).next)
+       (*func)((int)ptr);
+}
+
+template <class T, ListLink<T> T::*link>
+void
+IntrusiveList<T, link>::SortedInsert(T *item, int sortKey)
+{
+    T *ptr;
+
+    ASSERT(((item->*link).next == NULL) && (item != last));
+    (item->*link).key = sortKey;
+    if (IsEmpty()) {
+        first = last = item;
+    } else if (sortKey < (first->*link).key) {	// item goes on front
+        (item->*link).next = first;
+        first = item;
+    } else {			// look for first item bigger than this one
+        for (ptr = first; (ptr->*link).next != NULL; ptr = (ptr->*link).next) {
+            if (sortKey < ((ptr->*link).next->*link).key) {
+                (item->*link).next = (ptr->*link).next;
+                (ptr->*link).next = item;
+                return;
+            }
+        }
+        (last->*link).next = item;	// item goes at end of list
+        last = item;
+    }
+}
+
+template <class T, ListLink<T> T::*link>
+T *
+IntrusiveList<T, link>::SortedRemove(int *keyPtr)
+{
+    T *thing = first;
+
+    if (IsEmpty())
+        return NULL;
+    first = (thing->*link).next;
+    if (first == NULL) last = NULL;
+    (thing->*link).next = NULL;
+    if (keyPtr != NULL)
+        *keyPtr = (thing->*link).key;
+    return thing;
+}
+
+template <class T, ListLink<T> T::*link>
+T *
+IntrusiveList<T, link>::RemoveMin(int (T::*keyOf)(void))
+{
+    T *ptr, *prev, *min, *minprev = NULL;
+    int minimum;
+
+    if (IsEmpty())
+        return NULL;
+    min = first;
+    minimum = (first->*keyOf)();
+    for (prev = first, ptr = (first->*link).next; ptr != NULL; prev = ptr, ptr = (ptr->*link).next) {
+        if ((ptr->*keyOf)() < minimum) {
+            min = ptr;
+            minprev = prev;
+            minimum = (ptr->*keyOf)();
+        }
+    }
+    if (minprev == NULL) first = (min->*link).next;
+    else (minprev->*link).next = (min->*link).next;
+    if (last == min) last = minprev;
+    (min->*link).next = NULL;
+    return min;
+}
+
 #endif // LIST_H
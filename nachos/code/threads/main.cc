@@ -14,11 +14,12 @@
 //		-p <nachos file> -r <nachos file> -l -D -t
 //              -n <network reliability> -m <machine id>
 //              -o <other machine id>
-//              -z
+//              -z -B <reps>
 //
 //    -d causes certain debugging messages to be printed (cf. utility.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
 //    -z prints the copyright message
+//    -B runs the kernel microbenchmarks, <reps> samples each
 //
 //  USER_PROGRAM
 //    -s causes user programs to be executed in single-step mode
@@ -56,7 +57,7 @@
 
 // External functions used by this file
 
-extern void ThreadTest(void), Copy(char *unixFile, char *nachosFile);
+extern void ThreadTest(void), BenchmarkTest(int reps), Copy(char *unixFile, char *nachosFile);
 extern void Print(char *file), PerformanceTest(void);
 extern void StartUserProcess(char *file), ConsoleTest(char *in, char *out);
 extern void MailTest(int networkID);
@@ -96,6 +97,11 @@ main(int argc, char **argv)
 	argCount = 1;
         if (!strcmp(*argv, "-z"))               // print copyright
             printf (copyright);
+        if (!strcmp(*argv, "-B")) {		// run kernel microbenchmarks
+            ASSERT(argc > 1);
+            BenchmarkTest(atoi(*(argv + 1)));
+            argCount = 2;
+        }
 #ifdef USER_PROGRAM
         if (!strcmp(*argv, "-A")) {		// read scheduling algorithm
            schedulingAlgo = atoi(*(argv + 1));
@@ -119,7 +125,7 @@ main(int argc, char **argv)
         } else if (!strcmp(*argv, "-R")) {		// read page replacement algorithm
            pageReplacementAlgo = atoi(*(argv + 1));
            argCount = 2;
-           ASSERT((pageReplacementAlgo > 0) && (pageReplacementAlgo <= 4));
+           ASSERT((pageReplacementAlgo > 0) && (pageReplacementAlgo <= ENHANCED_CLOCK));
        } else if (!strcmp(*argv, "-x")) {        	// run a user program
 	    ASSERT(argc > 1);
             StartUserProcess(*(argv + 1));
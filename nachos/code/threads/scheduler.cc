@@ -29,7 +29,7 @@
 
 NachOSscheduler::NachOSscheduler()
 { 
-    readyThreadList = new List;
+    readyThreadList = new ThreadList;
     empty_ready_queue_start_time = -1;
 } 
 
@@ -82,7 +82,7 @@ NachOSscheduler::ThreadIsReadyToRun (NachOSThread *thread)
        stats->empty_ready_queue_time += (stats->totalTicks - empty_ready_queue_start_time);
        empty_ready_queue_start_time = -1;
     }
-    readyThreadList->Append((void *)thread);
+    readyThreadList->Append(thread);
 }
 
 //----------------------------------------------------------------------
@@ -97,10 +97,10 @@ NachOSThread *
 NachOSscheduler::FindNextThreadToRun ()
 {
     if ((schedulingAlgo == UNIX_SCHED) || (schedulingAlgo == NON_PREEMPTIVE_SJF)){
-       return (NachOSThread *)readyThreadList->GetMinPriorityThread();
+       return readyThreadList->RemoveMin(&NachOSThread::GetEffectivePriority);
     }
     else {
-       return (NachOSThread *)readyThreadList->Remove();
+       return readyThreadList->Remove();
     }
 }
 
@@ -239,8 +239,7 @@ NachOSscheduler::UpdateThreadPriority (void)
    // Update everybody else
 
    for (i=0; i<thread_index; i++) {
-      if ((i != currentPID) && !exitThreadArray[i]) {
-         ASSERT(threadArray[i] != NULL);
+      if ((i != currentPID) && !exitThreadArray[i] && (threadArray[i] != NULL)) {
          currentThreadUsage = threadArray[i]->GetUsage();
          currentThreadUsage = currentThreadUsage >> 1;
          currentThreadPriority = threadArray[i]->GetBasePriority() + (currentThreadUsage >> 1);
@@ -249,3 +248,19 @@ NachOSscheduler::UpdateThreadPriority (void)
       }
    }
 }
+
+//-------------------------------------------------------------------------
+// NachOSscheduler::EffectivePriorityChanged
+//      Called with interrupts disabled whenever a thread inherits a
+//      priority through a semaphore or gives it back.  The ready list
+//      is searched for the minimum effective priority each time a
+//      thread is picked, so a ready thread needs no repositioning; a
+//      blocked or running thread will be looked at when it next
+//      becomes ready.
+//--------------------------------------------------------------------------
+void
+NachOSscheduler::EffectivePriorityChanged (NachOSThread *thread)
+{
+   DEBUG('t', "Effective priority of thread %d (%s) is now %d\n", thread->GetPID(),
+         (thread->getStatus() == READY) ? "ready" : "not ready", thread->GetEffectivePriority());
+}
@@ -33,9 +33,12 @@ class NachOSscheduler {
     void SetEmptyReadyQueueStartTime (int ticks);
 
     void UpdateThreadPriority (void);	// Used by the UNIX scheduler
+
+    void EffectivePriorityChanged (NachOSThread *thread);	// Called on priority
+						// donation and its withdrawal
    
   private:
-    List *readyThreadList;  		// queue of threads that are ready to run,
+    ThreadList *readyThreadList;	// queue of threads that are ready to run,
 				// but not running
 
     int empty_ready_queue_start_time;
@@ -37,7 +37,8 @@ Semaphore::Semaphore(char* debugName, int initialValue)
 {
     name = debugName;
     value = initialValue;
-    queue = new List;
+    queue = new ThreadList;
+    holderPID = -1;
 }
 
 //----------------------------------------------------------------------
@@ -65,13 +66,23 @@ void
 Semaphore::P()
 {
     IntStatus oldLevel = interrupt->SetLevel(IntOff);	// disable interrupts
+    int inversionStart = -1;
     
     while (value == 0) { 			// semaphore not available
-	queue->Append((void *)currentThread);	// so go to sleep
+	if (PriorityInheritanceEnabled() && (holderPID != -1) && (holderPID != currentThread->GetPID())
+	    && DonatePriority(currentThread->GetEffectivePriority()) && (inversionStart == -1)) {
+	    stats->numPriorityInversions++;
+	    inversionStart = stats->totalTicks;
+	}
+	queue->Append(currentThread);	// so go to sleep
+	currentThread->SetBlockedOn(this);
 	currentThread->PutThreadToSleep();
     } 
     value--; 					// semaphore available, 
 						// consume its value
+    if (value == 0) holderPID = currentThread->GetPID();
+    if (inversionStart != -1)
+	stats->priorityInversionTime += (stats->totalTicks - inversionStart);
     
     (void) interrupt->SetLevel(oldLevel);	// re-enable interrupts
 }
@@ -82,31 +93,340 @@ Semaphore::P()
 //	As with P(), this operation must be atomic, so we need to disable
 //	interrupts.  NachOSscheduler::ThreadIsReadyToRun() assumes that threads
 //	are disabled when it is called.
+//
+//	With priority inheritance the waiter with the best effective
+//	priority is woken, and the previous holder gives back whatever
+//	priority it was lent through this semaphore.
 //----------------------------------------------------------------------
 
 void
 Semaphore::V()
 {
-    NachOSThread *thread;
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
 
-    thread = (NachOSThread *)queue->Remove();
-    if (thread != NULL)	   // make thread ready, consuming the V immediately
-	scheduler->ThreadIsReadyToRun(thread);
+    (void) WakeWaiter();	// make it ready, consuming the V immediately
     value++;
+    ReleaseHolder();
     (void) interrupt->SetLevel(oldLevel);
 }
 
+//----------------------------------------------------------------------
+// Semaphore::SetValue
+// 	Set the value to "v" >= 0.  As many waiters as the new value
+//	allows are woken, chosen as V() chooses them, and if the value
+//	is no longer zero the holder gives back its inherited priority.
+//----------------------------------------------------------------------
+
+void
+Semaphore::SetValue(int v)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    ASSERT(v >= 0);
+    value = v;
+    for (int i = 0; (i < v) && WakeWaiter(); i++);
+    if (value > 0) ReleaseHolder();
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Semaphore::WakeWaiter
+// 	Called with interrupts disabled.  Make ready the waiter with the
+//	best effective priority under priority inheritance, or else the
+//	first one.  Returns FALSE if nobody was waiting.
+//----------------------------------------------------------------------
+
+bool
+Semaphore::WakeWaiter()
+{
+    NachOSThread *thread;
+
+    if (PriorityInheritanceEnabled())
+	thread = queue->RemoveMin(&NachOSThread::GetEffectivePriority);
+    else
+	thread = queue->Remove();
+    if (thread == NULL) return FALSE;
+    thread->SetBlockedOn(NULL);
+    scheduler->ThreadIsReadyToRun(thread);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Semaphore::ReleaseHolder
+// 	Called with interrupts disabled once the value is above zero:
+//	there is no holder any more, and the previous one gives back
+//	whatever priority it was lent through this semaphore.
+//----------------------------------------------------------------------
+
+void
+Semaphore::ReleaseHolder()
+{
+    NachOSThread *oldHolder = GetHolder();
+
+    holderPID = -1;
+    if (PriorityInheritanceEnabled() && (oldHolder != NULL))
+	oldHolder->RecomputeInheritedPriority();
+}
+
+//----------------------------------------------------------------------
+// Semaphore::GetHolder
+// 	Return the thread that took the value to zero, or NULL if there
+//	is none or it has been destroyed since.
+//----------------------------------------------------------------------
+
+NachOSThread *
+Semaphore::GetHolder()
+{
+    if (holderPID == -1) return NULL;
+    return threadArray[holderPID];
+}
+
+//----------------------------------------------------------------------
+// Semaphore::DonatePriority
+// 	Called with interrupts disabled by a thread about to wait in P().
+//	Lend priority "p" to the holder, then to the holder of whatever
+//	semaphore the holder is itself waiting on, and so on down the
+//	chain, stopping at the first thread that already runs at p or
+//	better.  This also terminates on a deadlock cycle.
+//
+//	Returns TRUE if the holder had to be boosted, i.e. this wait is
+//	a priority inversion.
+//----------------------------------------------------------------------
+
+bool
+Semaphore::DonatePriority(int p)
+{
+    NachOSThread *t = GetHolder();
+    bool donated = FALSE;
+
+    while ((t != NULL) && (t->GetEffectivePriority() > p)) {
+	DEBUG('t', "Thread %d lends priority %d to thread %d\n", currentThread->GetPID(), p, t->GetPID());
+	t->InheritPriority(p);
+	scheduler->EffectivePriorityChanged(t);
+	donated = TRUE;
+	t = (t->GetBlockedOn() != NULL) ? t->GetBlockedOn()->GetHolder() : NULL;
+    }
+    return donated;
+}
+
+//----------------------------------------------------------------------
+// Lock::Lock
+// 	A lock is a binary semaphore that remembers its owner.  Priority
+//	inheritance comes from the semaphore.
+//----------------------------------------------------------------------
+
+Lock::Lock(char* debugName)
+{
+    name = debugName;
+    sem = new Semaphore(debugName, 1);
+    owner = NULL;
+}
+
+Lock::~Lock()
+{
+    delete sem;
+}
+
+void
+Lock::Acquire()
+{
+    ASSERT(!isHeldByCurrentThread());
+    sem->P();
+    owner = currentThread;
+}
+
+void
+Lock::Release()
+{
+    ASSERT(isHeldByCurrentThread());
+    owner = NULL;
+    sem->V();
+}
+
+bool
+Lock::isHeldByCurrentThread()
+{
+    return (owner == currentThread);
+}
+
 // Dummy functions -- so we can compile our later assignments 
 // Note -- without a correct implementation of Condition::Wait(), 
 // the test case in the network assignment won't work!
-Lock::Lock(char* debugName) {}
-Lock::~Lock() {}
-void Lock::Acquire() {}
-void Lock::Release() {}
-
 Condition::Condition(char* debugName) { }
 Condition::~Condition() { }
 void Condition::Wait(Lock* conditionLock) { ASSERT(FALSE); }
 void Condition::Signal(Lock* conditionLock) { }
 void Condition::Broadcast(Lock* conditionLock) { }
+
+//----------------------------------------------------------------------
+// Barrier::Barrier
+// 	Initialize a barrier for "count" participants.
+//----------------------------------------------------------------------
+
+Barrier::Barrier(char* debugName, int participants)
+{
+    ASSERT(participants > 0);
+    name = debugName;
+    count = participants;
+    arrived = 0;
+    queue = new ThreadList;
+}
+
+Barrier::~Barrier()
+{
+    delete queue;
+}
+
+//----------------------------------------------------------------------
+// Barrier::Wait
+// 	Wait until all participants have arrived.  The last one to arrive
+//	empties the wait queue into the ready list in one pass and starts
+//	the next round.
+//----------------------------------------------------------------------
+
+void
+Barrier::Wait()
+{
+    NachOSThread *thread;
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    arrived++;
+    if (arrived < count) {
+	queue->Append(currentThread);
+	currentThread->PutThreadToSleep();
+    }
+    else {
+	DEBUG('t', "Barrier %s released by thread %d\n", name, currentThread->GetPID());
+	arrived = 0;
+	while ((thread = queue->Remove()) != NULL)
+	    scheduler->ThreadIsReadyToRun(thread);
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// RWLock::RWLock
+// 	Initialize a reader-writer lock to be free.
+//----------------------------------------------------------------------
+
+RWLock::RWLock(char* debugName, bool preferWriters)
+{
+    name = debugName;
+    writerPreference = preferWriters;
+    readers = 0;
+    writer = FALSE;
+    waitingWriters = 0;
+    readQueue = new ThreadList;
+    writeQueue = new ThreadList;
+}
+
+RWLock::~RWLock()
+{
+    delete readQueue;
+    delete writeQueue;
+}
+
+void
+RWLock::WakeAll(ThreadList *queue)
+{
+    NachOSThread *thread;
+
+    while ((thread = queue->Remove()) != NULL)
+	scheduler->ThreadIsReadyToRun(thread);
+}
+
+void
+RWLock::WakeOne(ThreadList *queue)
+{
+    NachOSThread *thread = queue->Remove();
+
+    if (thread != NULL)
+	scheduler->ThreadIsReadyToRun(thread);
+}
+
+//----------------------------------------------------------------------
+// RWLock::AcquireRead
+// 	Wait until no writer holds the lock (and, with writer preference,
+//	none is waiting for it), then join the readers.
+//----------------------------------------------------------------------
+
+void
+RWLock::AcquireRead()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    while (writer || (writerPreference && (waitingWriters > 0))) {
+	readQueue->Append(currentThread);
+	currentThread->PutThreadToSleep();
+    }
+    readers++;
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// RWLock::ReleaseRead
+// 	The last reader out lets a writer in.  Returns FALSE, and does
+//	nothing, if no reader holds the lock: the caller may be a user
+//	program releasing a lock it never took.
+//----------------------------------------------------------------------
+
+bool
+RWLock::ReleaseRead()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    if (readers == 0) {
+	(void) interrupt->SetLevel(oldLevel);
+	return FALSE;
+    }
+    readers--;
+    if (readers == 0) WakeOne(writeQueue);
+    (void) interrupt->SetLevel(oldLevel);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// RWLock::AcquireWrite
+// 	Wait until nobody holds the lock, then take it exclusively.
+//----------------------------------------------------------------------
+
+void
+RWLock::AcquireWrite()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    waitingWriters++;
+    while (writer || (readers > 0)) {
+	writeQueue->Append(currentThread);
+	currentThread->PutThreadToSleep();
+    }
+    waitingWriters--;
+    writer = TRUE;
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// RWLock::ReleaseWrite
+// 	With writer preference, hand the lock to the next writer if there
+//	is one.  Otherwise let in all waiting readers at once, or failing
+//	that, the next writer.  Returns FALSE, and does nothing, if no
+//	writer holds the lock.
+//----------------------------------------------------------------------
+
+bool
+RWLock::ReleaseWrite()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    if (!writer) {
+	(void) interrupt->SetLevel(oldLevel);
+	return FALSE;
+    }
+    writer = FALSE;
+    if ((writerPreference && !writeQueue->IsEmpty()) || readQueue->IsEmpty())
+	WakeOne(writeQueue);
+    else
+	WakeAll(readQueue);
+    (void) interrupt->SetLevel(oldLevel);
+    return TRUE;
+}
@@ -36,6 +36,16 @@
 // into a register, a context switch might have occurred,
 // and some other thread might have called P or V, so the true value might
 // now be different.
+//
+// Under the UNIX and SJF schedulers, semaphores implement priority
+// inheritance.  The thread whose P() takes the last unit of the value
+// is remembered as the "holder" until the next V().  A thread that
+// has to wait in P() lends its effective priority to the holder, and
+// transitively to whoever the holder is waiting on, so that a low
+// priority holder cannot be starved by medium priority threads while
+// a high priority thread waits for it.  This is exactly the right
+// thing for semaphores used as locks (initial value 1, and so for
+// Lock below) and harmless for the others.
 
 class Semaphore {
   public:
@@ -45,11 +55,24 @@ class Semaphore {
     
     void P();	 // these are the only operations on a semaphore
     void V();	 // they are both *atomic*
+
+    NachOSThread *GetHolder();		// Used for priority inheritance
+    int GetValue() { return value; }			// Used by SYScall_SemCtl
+    void SetValue(int v);		// Used by SYScall_SemCtl; *atomic*
+    bool HasWaiters() { return !queue->IsEmpty(); }	// May it be deleted?
     
   private:
     char* name;        // useful for debugging
     int value;         // semaphore value, always >= 0
-    List *queue;       // threads waiting in P() for the value to be > 0
+    ThreadList *queue; // threads waiting in P() for the value to be > 0
+    int holderPID;	// pid of the thread that took the value to zero, or -1;
+			// V() may come from an interrupt handler after the
+			// holder is gone, so we do not keep a pointer
+
+    bool DonatePriority(int p);	// Lend priority p down the chain of holders
+    bool WakeWaiter();		// Make the waiter V() would pick ready
+    void ReleaseHolder();	// Forget the holder, which gives back
+				// the priority lent through us
 };
 
 // The following class defines a "lock".  A lock can be BUSY or FREE.
@@ -80,7 +103,9 @@ class Lock {
 
   private:
     char* name;				// for debugging
-    // plus some other stuff you'll need to define
+    Semaphore *sem;			// binary semaphore; its priority
+					// inheritance carries over to the lock
+    NachOSThread *owner;		// thread holding the lock, if any
 };
 
 // The following class defines a "condition variable".  A condition
@@ -134,4 +159,65 @@ class Condition {
     char* name;
     // plus some other stuff you'll need to define
 };
+// The following class defines a "barrier" for a fixed number of
+// participants.  The only operation is:
+//
+//	Wait() -- block until "count" threads (including the caller) have
+//		called Wait(), then let all of them continue
+//
+// The last thread to arrive makes all the others ready in a single pass
+// with interrupts disabled, so they re-enter the ready list together
+// instead of trickling in one V() at a time.  The barrier is reusable;
+// a thread that races ahead into the next round simply waits for the
+// next "count" arrivals.
+
+class Barrier {
+  public:
+    Barrier(char* debugName, int count);	// count = # of participants
+    ~Barrier();
+    char* getName() { return name; }
+
+    void Wait();			// atomic
+
+  private:
+    char* name;
+    int count;				// participants per round
+    int arrived;			// arrivals so far in this round
+    ThreadList *queue;			// threads waiting for the round to end
+};
+
+// The following class defines a "reader-writer lock".  Any number of
+// readers may hold it at once, or one writer alone:
+//
+//	AcquireRead/ReleaseRead -- shared access
+//	AcquireWrite/ReleaseWrite -- exclusive access
+//
+// With "writerPreference", a waiting writer blocks new readers, so a
+// stream of readers cannot starve writers; otherwise readers are let in
+// whenever no writer holds the lock, which maximizes read concurrency.
+// A released writer lets in all waiting readers at once.
+
+class RWLock {
+  public:
+    RWLock(char* debugName, bool writerPreference);
+    ~RWLock();
+    char* getName() { return name; }
+
+    void AcquireRead();			// these are all *atomic*
+    bool ReleaseRead();			// FALSE if no reader held the lock
+    void AcquireWrite();
+    bool ReleaseWrite();		// FALSE if no writer held the lock
+
+  private:
+    char* name;
+    bool writerPreference;
+    int readers;			// # of readers holding the lock
+    bool writer;			// is a writer holding the lock?
+    int waitingWriters;			// # of writers in AcquireWrite
+    ThreadList *readQueue;		// readers waiting
+    ThreadList *writeQueue;		// writers waiting
+
+    void WakeAll(ThreadList *queue);	// make every waiter ready
+    void WakeOne(ThreadList *queue);	// make the first waiter ready
+};
 #endif // SYNCH_H
@@ -11,4 +11,10 @@
 #define COND_OP_SIGNAL		1
 #define COND_OP_BROADCAST	2
 
+// Reader-writer lock ops
+#define RWLOCK_OP_READ_ACQUIRE		0
+#define RWLOCK_OP_READ_RELEASE		1
+#define RWLOCK_OP_WRITE_ACQUIRE		2
+#define RWLOCK_OP_WRITE_RELEASE		3
+
 #endif
@@ -34,6 +34,11 @@ char **batchProcesses;			// Names of batch processes
 int *priority;				// Process priority
 
 int pageReplacementAlgo;                // page replacement algo
+int pageoutLow, pageoutHigh;		// pageout daemon watermarks
+int faultClusterSize;			// pages brought in per page fault
+int maxReadAhead;			// largest sequential read-ahead window
+int mergeBudget;			// ticks per run of the page merger
+int maxPrepage;				// largest working set brought back at once
 
 int cpu_burst_start_time;        // Records the start of current CPU burst
 int completionTimeArray[MAX_THREAD_COUNT];        // Records the completion time of all simulated threads
@@ -50,6 +55,20 @@ SynchDisk   *synchDisk;
 #ifdef USER_PROGRAM	// requires either FILESYS or FILESYS_STUB
 Machine *machine;	// user program memory and registers
 int NumPhysPages;
+FutexTable *futexTable;
+SwapSpace *swapSpace;
+TextPageCache *textCache;
+TextPageCache *mmapCache;
+ShmTable *shmTable;
+PageTrace *pageTrace;
+int tlbSize;
+TLBManager *tlbManager;
+Semaphore *semaphoreArray[MAX_SEMAPHORE_COUNT];
+int semaphoreKey[MAX_SEMAPHORE_COUNT];
+Barrier *barrierArray[MAX_BARRIER_COUNT];
+int barrierKey[MAX_BARRIER_COUNT];
+RWLock *rwlockArray[MAX_RWLOCK_COUNT];
+int rwlockKey[MAX_RWLOCK_COUNT];
 #endif
 
 #ifdef NETWORK
@@ -123,6 +142,11 @@ Initialize(int argc, char **argv)
 
     schedulingAlgo = NON_PREEMPTIVE_BASE;	// Default
     pageReplacementAlgo = NONE;                 // Default
+    pageoutLow = pageoutHigh = 0;		// no pageout daemon
+    mergeBudget = 0;				// no page merging
+    maxPrepage = 0;				// no prepaging
+    faultClusterSize = 1;			// no clustering
+    maxReadAhead = 0;				// no read-ahead
 
     batchProcesses = new char*[MAX_BATCH_SIZE];
     ASSERT(batchProcesses != NULL);
@@ -143,6 +167,14 @@ Initialize(int argc, char **argv)
 
 #ifdef USER_PROGRAM
     bool debugUserProg = FALSE;	// single step user program
+    char *traceFile = NULL;	// where to record page references
+    int tlbPolicy = FIFO;	// TLB replacement algo
+    int zpoolBytes = 0;		// no compressed swap pool
+#ifdef USE_TLB
+    tlbSize = TLBSize;
+#else
+    tlbSize = 0;		// translate with the page table
+#endif
 #endif
 #ifdef FILESYS_NEEDED
     bool format = FALSE;	// format disk
@@ -175,6 +207,55 @@ Initialize(int argc, char **argv)
            NumPhysPages = atoi(*(argv + 1));
            argCount = 2;
         } 
+        else if (!strcmp(*argv, "-C")) {		// cluster page faults
+           ASSERT(argc > 1);
+           faultClusterSize = atoi(*(argv + 1));
+           ASSERT(faultClusterSize >= 1);
+           argCount = 2;
+        }
+        else if (!strcmp(*argv, "-ra")) {		// sequential read-ahead
+           ASSERT(argc > 1);
+           maxReadAhead = atoi(*(argv + 1));
+           ASSERT(maxReadAhead >= 0);
+           argCount = 2;
+        }
+        else if (!strcmp(*argv, "-O")) {		// run the pageout daemon
+           ASSERT(argc > 2);
+           pageoutLow = atoi(*(argv + 1));
+           pageoutHigh = atoi(*(argv + 2));
+           ASSERT((pageoutLow > 0) && (pageoutLow <= pageoutHigh));
+           argCount = 3;
+        }
+        else if (!strcmp(*argv, "-tr")) {		// trace page references
+           ASSERT(argc > 1);
+           traceFile = *(argv + 1);
+           argCount = 2;
+        }
+        else if (!strcmp(*argv, "-tlb")) {		// TLB size and replacement algo
+           ASSERT(argc > 2);
+           tlbSize = atoi(*(argv + 1));
+           tlbPolicy = atoi(*(argv + 2));
+           ASSERT(tlbSize >= 0);
+           argCount = 3;
+        }
+        else if (!strcmp(*argv, "-pp")) {		// prepage the working set
+           ASSERT(argc > 1);
+           maxPrepage = atoi(*(argv + 1));
+           ASSERT(maxPrepage >= 0);
+           argCount = 2;
+        }
+        else if (!strcmp(*argv, "-M")) {		// merge identical pages
+           ASSERT(argc > 1);
+           mergeBudget = atoi(*(argv + 1));
+           ASSERT(mergeBudget >= 0);
+           argCount = 2;
+        }
+        else if (!strcmp(*argv, "-Z")) {		// compressed swap pool, bytes
+           ASSERT(argc > 1);
+           zpoolBytes = atoi(*(argv + 1));
+           ASSERT(zpoolBytes >= 0);
+           argCount = 2;
+        }
 #endif
 #ifdef FILESYS_NEEDED
 	if (!strcmp(*argv, "-f"))
@@ -216,6 +297,17 @@ Initialize(int argc, char **argv)
     
 #ifdef USER_PROGRAM
     machine = new Machine(debugUserProg);	// this must come first
+    ASSERT(pageoutHigh < NumPhysPages);	// the daemon must leave some to map
+    futexTable = new FutexTable();
+    swapSpace = new SwapSpace("SWAP", zpoolBytes);
+    textCache = new TextPageCache(NumPhysPages);
+    mmapCache = new TextPageCache(NumPhysPages);
+    shmTable = new ShmTable();
+    pageTrace = (traceFile != NULL) ? new PageTrace(traceFile) : NULL;
+    tlbManager = (tlbSize > 0) ? new TLBManager(tlbPolicy) : NULL;
+    for (i=0; i<MAX_SEMAPHORE_COUNT; i++) semaphoreArray[i] = NULL;
+    for (i=0; i<MAX_BARRIER_COUNT; i++) barrierArray[i] = NULL;
+    for (i=0; i<MAX_RWLOCK_COUNT; i++) rwlockArray[i] = NULL;
 #endif
 
 #ifdef FILESYS
@@ -244,6 +336,13 @@ Cleanup()
 #endif
     
 #ifdef USER_PROGRAM
+    delete futexTable;
+    delete swapSpace;
+    delete textCache;
+    delete mmapCache;
+    delete shmTable;
+    if (pageTrace != NULL) delete pageTrace;
+    if (tlbManager != NULL) delete tlbManager;
     delete machine;
 #endif
 
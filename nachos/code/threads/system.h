@@ -25,6 +25,9 @@
 #define ROUND_ROBIN 		3
 #define UNIX_SCHED		4
 
+// Semaphores lend priority to their holders under the priority schedulers
+#define PriorityInheritanceEnabled()	((schedulingAlgo == UNIX_SCHED) || (schedulingAlgo == NON_PREEMPTIVE_SJF))
+
 #define SCHED_QUANTUM		100		// If not a multiple of timer interval, quantum will overshoot
 
 #define INITIAL_TAU		SystemTick	// Initial guess of the burst is set to the overhead of system activity
@@ -41,6 +44,9 @@
 #define FIFO                    2
 #define LRU                     3
 #define LRU_CLOCK               4
+#define WSCLOCK                 5	// working set clock, with load control
+#define PFF                     6	// page fault frequency, with load control
+#define ENHANCED_CLOCK          7	// clock on (referenced, dirty) classes
 // Initialization and cleanup routines
 extern void Initialize(int argc, char **argv); 	// Initialization,
 						// called before anything else
@@ -70,6 +76,14 @@ extern int completionTimeArray[];	// Records the completion time of all simulate
 extern bool excludeMainThread;		// Used by completion time statistics calculation
 
 extern int pageReplacementAlgo;
+extern int faultClusterSize;		// Pages brought in per fault (-C)
+extern int maxReadAhead;		// Largest read-ahead window (-ra), 0 if off
+extern int pageoutLow, pageoutHigh;	// Free frame watermarks of the pageout
+					// daemon (-O); disabled if pageoutLow is 0
+extern int maxPrepage;			// Largest working set recorded for
+					// prepaging (-pp), 0 if off
+extern int mergeBudget;			// Ticks per run of the page merger (-M),
+					// 0 if off
 
 class TimeSortedWaitQueue {		// Needed to implement system_call_Sleep
 private:
@@ -91,8 +105,34 @@ extern TimeSortedWaitQueue *sleepQueueHead;
 
 #ifdef USER_PROGRAM
 #include "machine.h"
+#include "futex.h"
+#include "swap.h"
+#include "textcache.h"
+#include "pagetrace.h"
+#include "tlbmgr.h"
+#include "shm.h"
+#include "synch.h"
+
+#define MAX_SEMAPHORE_COUNT	64	// Semaphores available through SYScall_SemGet
+#define MAX_BARRIER_COUNT	16	// Barriers available through SYScall_BarrierGet
+#define MAX_RWLOCK_COUNT	16	// Locks available through SYScall_RWLockGet
+
 extern Machine* machine;	// user program memory and registers
 extern int NumPhysPages;
+extern FutexTable *futexTable;	// wait queues for SYScall_FutexWait
+extern SwapSpace *swapSpace;	// backing store for evicted dirty pages
+extern TextPageCache *textCache;	// code pages shared between processes
+extern TextPageCache *mmapCache;	// pages of memory-mapped files
+extern ShmTable *shmTable;	// named shared memory segments
+extern PageTrace *pageTrace;	// page reference trace, NULL if not asked for
+extern int tlbSize;		// entries in the TLB, 0 if there is none (-tlb)
+extern TLBManager *tlbManager;	// refills the TLB, NULL if there is none
+extern Semaphore *semaphoreArray[];	// user semaphores, indexed by semid
+extern int semaphoreKey[];		// key each user semaphore was created with
+extern Barrier *barrierArray[];		// user barriers, indexed by barid
+extern int barrierKey[];
+extern RWLock *rwlockArray[];		// user reader-writer locks, indexed by rwid
+extern int rwlockKey[];
 #endif
 
 #ifdef FILESYS_NEEDED 		// FILESYS or FILESYS_STUB 
@@ -76,6 +76,8 @@ NachOSThread::NachOSThread(char* threadName, int nice)
     }
     schedPriority = basePriority;
     usage = 0;
+    inheritedPriority = NO_INHERITED_PRIORITY;
+    blockedOn = NULL;
 
     if (schedulingAlgo == NON_PREEMPTIVE_SJF) schedPriority = INITIAL_TAU;
 }
@@ -97,6 +99,7 @@ NachOSThread::~NachOSThread()
     DEBUG('t', "Deleting thread \"%s\"\n", name);
 
     ASSERT(this != currentThread);
+    threadArray[pid] = NULL;		// others scan threadArray
     if (stack != NULL)
 	DeallocBoundedArray((char *) stack, StackSize * sizeof(int));
 }
@@ -260,10 +263,16 @@ NachOSThread::Exit (bool terminateSim, int exitcode)
     status = BLOCKED;
     completionTimeArray[currentThread->GetPID()] = stats->totalTicks;
 
+#ifdef USER_PROGRAM
+    if (space != NULL) {		// give back its frames and swap slots
+       delete space;
+       space = NULL;
+    }
+#endif
+
     // Set exit code in parent's structure provided the parent hasn't exited
     if (ppid != -1) {
-       if (!exitThreadArray[ppid]) {
-          ASSERT(threadArray[ppid] != NULL);
+       if (!exitThreadArray[ppid] && (threadArray[ppid] != NULL)) {
           threadArray[ppid]->SetChildExitCode (pid, exitcode);
        }
     }
@@ -480,6 +489,8 @@ NachOSThread::SaveUserState()
     if (stateRestored) {
        for (int i = 0; i < NumTotalRegs; i++)
 	  userRegisters[i] = machine->ReadRegister(i);
+       if (space != NULL)
+          space->RestartAtomicSequence(userRegisters);
        stateRestored = false;
     }
 }
@@ -631,6 +642,37 @@ NachOSThread::SortedInsertInWaitQueue (unsigned when)
    (void) interrupt->SetLevel(oldLevel);
 }
 
+#ifdef USER_PROGRAM
+//----------------------------------------------------------------------
+// NachOSThread::WaitForPageIO
+//      Called after a page fault queued paging I/O that is done in
+//      "ticks": sleep until the disk interrupt signalling it, so that
+//      other threads run in the meantime.  "otherTicks" is added to the
+//      sleep without counting as I/O wait: compression, or load-control
+//      suspension.
+//----------------------------------------------------------------------
+
+static void
+PageIODone(int pid)
+{
+    scheduler->ThreadIsReadyToRun(threadArray[pid]);	// interrupts are off
+}
+
+void
+NachOSThread::WaitForPageIO (int ticks, int otherTicks)
+{
+   IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+   if (ticks > 0) {
+      stats->numPageIOWaits++;
+      stats->pageIOWaitTicks += ticks;
+   }
+   interrupt->Schedule(PageIODone, pid, ticks + otherTicks, DiskInt);
+   PutThreadToSleep();
+   (void) interrupt->SetLevel(oldLevel);
+}
+#endif
+
 //----------------------------------------------------------------------
 // NachOSThread::IncInstructionCount
 //      Called by Machine::Run to update instruction count
@@ -714,3 +756,53 @@ NachOSThread::GetUsage (void)
 {
    return usage;
 }
+
+//----------------------------------------------------------------------
+// NachOSThread::GetEffectivePriority
+//      Priority used for picking the next thread to run.  This is the
+//      own priority, unless a thread waiting on a semaphore we hold has
+//      lent us a better (numerically smaller) one.
+//----------------------------------------------------------------------
+
+int
+NachOSThread::GetEffectivePriority (void)
+{
+   return (inheritedPriority < schedPriority) ? inheritedPriority : schedPriority;
+}
+
+//----------------------------------------------------------------------
+// NachOSThread::RecomputeInheritedPriority
+//      Called with interrupts disabled when we release a semaphore, so
+//      that the donations of its waiters no longer count.  The inherited
+//      priority becomes the best effective priority among the threads
+//      still waiting on semaphores we hold.  If we are ourselves blocked,
+//      the holder we are waiting on may have lost a donation too, so the
+//      recomputation walks down the chain.
+//----------------------------------------------------------------------
+
+void
+NachOSThread::RecomputeInheritedPriority (void)
+{
+   NachOSThread *t = this;
+   Semaphore *s;
+   unsigned i, steps = 0;
+   int p, waiterPriority;
+
+   while ((t != NULL) && (steps < thread_index)) {	// bounded in case of a deadlock cycle
+      p = NO_INHERITED_PRIORITY;
+      for (i=0; i<thread_index; i++) {
+         if (!exitThreadArray[i] && (threadArray[i] != NULL)) {
+            s = threadArray[i]->GetBlockedOn();
+            if ((s != NULL) && (s->GetHolder() == t)) {
+               waiterPriority = threadArray[i]->GetEffectivePriority();
+               if (waiterPriority < p) p = waiterPriority;
+            }
+         }
+      }
+      if (p == t->inheritedPriority) break;
+      t->inheritedPriority = p;
+      scheduler->EffectivePriorityChanged(t);
+      t = (t->blockedOn != NULL) ? t->blockedOn->GetHolder() : NULL;
+      steps++;
+   }
+}
@@ -41,6 +41,7 @@
 
 #include "copyright.h"
 #include "utility.h"
+#include "list.h"
 
 #ifdef USER_PROGRAM
 #include "machine.h"
@@ -58,6 +59,11 @@
 #define StackSize	(4 * 1024)	// in words
 
 
+// Effective priority of a thread that nobody is donating to
+#define NO_INHERITED_PRIORITY	0x7fffffff
+
+class Semaphore;
+
 // NachOSThread state
 enum ThreadStatus { JUST_CREATED, RUNNING, READY, BLOCKED };
 
@@ -133,6 +139,10 @@ class NachOSThread {
     void Startup();					// Called by the startup function of SYScall_Fork to cleanly start a forked child after it is scheduled
 
     void SortedInsertInWaitQueue (unsigned when);	// Called by SYScall_Sleep handler
+#ifdef USER_PROGRAM
+    void WaitForPageIO (int ticks, int otherTicks);	// Sleep until the paging I/O of a
+							// fault completes, and then some
+#endif
 
     void IncInstructionCount();
     unsigned GetInstructionCount();
@@ -152,6 +162,17 @@ class NachOSThread {
     void SetUsage (int usage);
     int GetUsage (void);
 
+    int GetEffectivePriority (void);	// Smaller of own and inherited priority
+    void InheritPriority (int p) { inheritedPriority = p; }
+    void RecomputeInheritedPriority (void);	// Called when a donor goes away
+
+    void SetBlockedOn (Semaphore *s) { blockedOn = s; }
+    Semaphore *GetBlockedOn (void) { return blockedOn; }
+
+    ListLink<NachOSThread> queueLink;	// Links us into the ready list or
+					// whichever wait queue we are on;
+					// a thread is on at most one
+
   private:
     // some of the private data for this class is listed above
     
@@ -176,6 +197,9 @@ class NachOSThread {
 
     int basePriority, schedPriority, usage;	// Used by the UNIX scheduler
 						// schedPriority is also used to store the next burst estimate
+    int inheritedPriority;		// Best priority lent by threads waiting on a
+					// semaphore we hold (NO_INHERITED_PRIORITY if none)
+    Semaphore *blockedOn;		// Semaphore we are waiting in P() on, if any
 
     unsigned instructionCount;          // Keeps track of the instruction count executed by this thread
 
@@ -195,6 +219,10 @@ class NachOSThread {
 #endif
 };
 
+// A queue of threads linked through NachOSThread::queueLink, used by
+// the ready list and the synchronization primitives.
+typedef IntrusiveList<NachOSThread, &NachOSThread::queueLink> ThreadList;
+
 // Magical machine-dependent routines, defined in switch.s
 
 extern "C" {
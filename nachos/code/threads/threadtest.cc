@@ -5,12 +5,16 @@
 //	back and forth between themselves by calling NachOSThread::YieldCPU, 
 //	to illustratethe inner workings of the thread system.
 //
+//	Also contains BenchmarkTest, a set of microbenchmarks of the
+//	kernel's hot paths (nachos -B <reps>).
+//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
 #include "system.h"
+#include "synch.h"
 
 //----------------------------------------------------------------------
 // SimpleThread
@@ -49,3 +53,336 @@ ThreadTest()
     SimpleThread(0);
 }
 
+
+//----------------------------------------------------------------------
+// Kernel microbenchmarks
+//	Each case repeats a sample of a fixed number of operations "reps"
+//	times, and reports the 50th, 90th and 99th percentile over the
+//	samples of the cost of one operation, both in simulated ticks and
+//	in host nanoseconds.  Every case prints one line of the form
+//
+//	BENCH name=<case> reps=<n> ops=<ops per sample> ticks_p50=<t> ...
+//
+//	so that runs can be compared with a script.  The simulated cost
+//	only changes if the kernel's accounting changes; the host cost is
+//	what regressions in the code itself show up in.
+//
+//	The thread ids handed out by the constructor are never reused and
+//	every thread is recorded as a child of its creator, so the cases
+//	that create threads do so sparingly, and the fork/finish case may
+//	run fewer samples than asked for.
+//----------------------------------------------------------------------
+
+#define BENCH_OPS		1000	// operations per sample, most cases
+#define BENCH_CHURN_OPS		16	// threads created per fork/finish sample
+#define BENCH_MAX_CHURN_REPS	40	// each churn sample is a child of main
+#define BENCH_SLEEP_OPS		20	// sleeps per sample
+#define BENCH_READY_THREADS	16	// threads cycled through the ready list
+#define BENCH_MAX_DELAY		64	// spread of the benchmark interrupts
+
+static double *benchTicks, *benchNs;	// per operation cost, one per sample
+static int benchStartTicks;
+static double benchStartNs;
+
+static bool benchDone;			// tells partner threads to quit
+static Semaphore *benchPing, *benchPong, *benchExit;
+static Semaphore *benchChurnDone;
+static int benchChurnLeft;
+static int benchInterruptsFired;
+
+static void
+BenchStart()
+{
+    benchStartTicks = stats->totalTicks;
+    benchStartNs = HostNanoseconds();
+}
+
+static void
+BenchStop(int rep, int ops)
+{
+    benchNs[rep] = (HostNanoseconds() - benchStartNs) / ops;
+    benchTicks[rep] = (double)(stats->totalTicks - benchStartTicks) / ops;
+}
+
+static void
+BenchSort(double *a, int n)
+{
+    int i, j;
+    double x;
+
+    for (i = 1; i < n; i++) {
+       x = a[i];
+       for (j = i; (j > 0) && (a[j-1] > x); j--) a[j] = a[j-1];
+       a[j] = x;
+    }
+}
+
+// Nearest rank percentile of the sorted samples a[0..n-1]
+static double
+BenchPercentile(double *a, int n, int p)
+{
+    int rank = (p * n + 99) / 100;
+
+    if (rank < 1) rank = 1;
+    return a[rank - 1];
+}
+
+static void
+BenchReport(char *name, int reps, int ops)
+{
+    BenchSort(benchTicks, reps);
+    BenchSort(benchNs, reps);
+    printf("BENCH name=%s reps=%d ops=%d ticks_p50=%.2f ticks_p90=%.2f ticks_p99=%.2f ns_p50=%.1f ns_p90=%.1f ns_p99=%.1f\n",
+           name, reps, ops,
+           BenchPercentile(benchTicks, reps, 50), BenchPercentile(benchTicks, reps, 90),
+           BenchPercentile(benchTicks, reps, 99),
+           BenchPercentile(benchNs, reps, 50), BenchPercentile(benchNs, reps, 90),
+           BenchPercentile(benchNs, reps, 99));
+    fflush(stdout);
+}
+
+// Keeps another thread on the ready list until benchDone is set.
+// Also used by the sleep case: in idle mode the timer does not wake
+// up sleepers, so somebody has to be runnable.
+static void
+BenchYieldPartner(int dummy)
+{
+    while (!benchDone) currentThread->YieldCPU();
+    benchExit->V();
+}
+
+static void
+BenchPingPartner(int total)
+{
+    for (int i = 0; i < total; i++) {
+       benchPing->P();
+       benchPong->V();
+    }
+    benchExit->V();
+}
+
+// Each thread of the chain forks its successor, then finishes.
+static void
+BenchChurnThread(int dummy)
+{
+    NachOSThread *t;
+
+    if (--benchChurnLeft > 0) {
+       t = new NachOSThread("bench churn", GET_NICE_FROM_PARENT);
+       t->ThreadFork(BenchChurnThread, 0);
+    }
+    else benchChurnDone->V();
+}
+
+static void
+BenchInterruptHandler(int dummy)
+{
+    benchInterruptsFired++;
+}
+
+//----------------------------------------------------------------------
+// BenchYield
+// 	Context switch through YieldCPU, ping-ponging with a partner.
+//----------------------------------------------------------------------
+
+static void
+BenchYield(int reps)
+{
+    NachOSThread *t = new NachOSThread("bench yield", GET_NICE_FROM_PARENT);
+    int r, i;
+
+    benchDone = FALSE;
+    t->ThreadFork(BenchYieldPartner, 0);
+    for (r = 0; r < reps; r++) {
+       BenchStart();
+       for (i = 0; i < BENCH_OPS; i++) currentThread->YieldCPU();
+       BenchStop(r, BENCH_OPS);
+    }
+    benchDone = TRUE;
+    benchExit->P();
+    BenchReport("yield", reps, BENCH_OPS);
+}
+
+//----------------------------------------------------------------------
+// BenchSemaphore
+// 	One V() and one P() on each side per operation, with a context
+//	switch each way.
+//----------------------------------------------------------------------
+
+static void
+BenchSemaphore(int reps)
+{
+    NachOSThread *t = new NachOSThread("bench ping", GET_NICE_FROM_PARENT);
+    int r, i;
+
+    t->ThreadFork(BenchPingPartner, reps * BENCH_OPS);
+    for (r = 0; r < reps; r++) {
+       BenchStart();
+       for (i = 0; i < BENCH_OPS; i++) {
+          benchPing->V();
+          benchPong->P();
+       }
+       BenchStop(r, BENCH_OPS);
+    }
+    benchExit->P();
+    BenchReport("semaphore_pingpong", reps, BENCH_OPS);
+}
+
+//----------------------------------------------------------------------
+// BenchForkFinish
+// 	ThreadFork, first dispatch and FinishThread of a chain of threads.
+//----------------------------------------------------------------------
+
+static void
+BenchForkFinish(int reps)
+{
+    NachOSThread *t;
+    int r;
+    int room = ((int)MAX_THREAD_COUNT - (int)thread_index - BENCH_READY_THREADS - 8) / BENCH_CHURN_OPS;
+
+    if (reps > BENCH_MAX_CHURN_REPS) reps = BENCH_MAX_CHURN_REPS;
+    if (reps > room) reps = room;
+    if (reps <= 0) {
+       printf("# fork_finish skipped: out of thread ids\n");
+       return;
+    }
+    for (r = 0; r < reps; r++) {
+       benchChurnLeft = BENCH_CHURN_OPS;
+       BenchStart();
+       t = new NachOSThread("bench churn", GET_NICE_FROM_PARENT);
+       t->ThreadFork(BenchChurnThread, 0);
+       benchChurnDone->P();
+       BenchStop(r, BENCH_CHURN_OPS);
+    }
+    BenchReport("fork_finish", reps, BENCH_CHURN_OPS);
+}
+
+//----------------------------------------------------------------------
+// BenchInterrupts
+// 	Interrupt::Schedule plus delivery of the interrupt.  Normally only
+//	the device simulators call Schedule; here we schedule do-nothing
+//	interrupts a little into the future and tick until all have fired.
+//----------------------------------------------------------------------
+
+static void
+BenchInterrupts(int reps)
+{
+    IntStatus oldLevel;
+    int r, i;
+
+    for (r = 0; r < reps; r++) {
+       benchInterruptsFired = 0;
+       BenchStart();
+       oldLevel = interrupt->SetLevel(IntOff);
+       for (i = 0; i < BENCH_OPS; i++)
+          interrupt->Schedule(BenchInterruptHandler, 0, 1 + (i % BENCH_MAX_DELAY), DiskInt);
+       while (benchInterruptsFired < BENCH_OPS) {
+          (void) interrupt->SetLevel(IntOn);	// advances time, fires what is due
+          (void) interrupt->SetLevel(IntOff);
+       }
+       (void) interrupt->SetLevel(oldLevel);
+       BenchStop(r, BENCH_OPS);
+    }
+    BenchReport("interrupt_schedule", reps, BENCH_OPS);
+}
+
+//----------------------------------------------------------------------
+// BenchSleep
+// 	Insertion into the sleep queue, and wakeup by the timer.
+//----------------------------------------------------------------------
+
+static void
+BenchSleep(int reps)
+{
+    NachOSThread *t = new NachOSThread("bench spinner", GET_NICE_FROM_PARENT);
+    int r, i;
+
+    benchDone = FALSE;
+    t->ThreadFork(BenchYieldPartner, 0);
+    for (r = 0; r < reps; r++) {
+       BenchStart();
+       for (i = 0; i < BENCH_SLEEP_OPS; i++)
+          currentThread->SortedInsertInWaitQueue(stats->totalTicks + 1);
+       BenchStop(r, BENCH_SLEEP_OPS);
+    }
+    benchDone = TRUE;
+    benchExit->P();
+    BenchReport("sleep_wake", reps, BENCH_SLEEP_OPS);
+}
+
+//----------------------------------------------------------------------
+// BenchReadyQueue
+// 	ThreadIsReadyToRun plus FindNextThreadToRun, under each scheduling
+//	algorithm, on a private scheduler so the real ready list is not
+//	disturbed.  The threads are never run, and have distinct priorities
+//	so that the priority schedulers have to search.
+//----------------------------------------------------------------------
+
+static void
+BenchReadyQueue(int reps)
+{
+    NachOSscheduler *sched = new NachOSscheduler();
+    NachOSThread *t[BENCH_READY_THREADS];
+    int savedAlgo = schedulingAlgo;
+    int rounds = BENCH_OPS / BENCH_READY_THREADS;
+    IntStatus oldLevel;
+    char name[32];
+    int algo, r, k, i;
+
+    for (i = 0; i < BENCH_READY_THREADS; i++) {
+       t[i] = new NachOSThread("bench ready", GET_NICE_FROM_PARENT);
+       t[i]->SetPriority((i * 7) % BENCH_READY_THREADS);
+    }
+    for (algo = NON_PREEMPTIVE_BASE; algo <= UNIX_SCHED; algo++) {
+       schedulingAlgo = algo;
+       for (r = 0; r < reps; r++) {
+          oldLevel = interrupt->SetLevel(IntOff);
+          BenchStart();
+          for (k = 0; k < rounds; k++) {
+             for (i = 0; i < BENCH_READY_THREADS; i++) sched->ThreadIsReadyToRun(t[i]);
+             for (i = 0; i < BENCH_READY_THREADS; i++) (void) sched->FindNextThreadToRun();
+          }
+          BenchStop(r, rounds * BENCH_READY_THREADS);
+          (void) interrupt->SetLevel(oldLevel);
+       }
+       sprintf(name, "ready_queue_algo%d", algo);
+       BenchReport(name, reps, rounds * BENCH_READY_THREADS);
+    }
+    schedulingAlgo = savedAlgo;
+    for (i = 0; i < BENCH_READY_THREADS; i++) delete t[i];
+    delete sched;
+}
+
+//----------------------------------------------------------------------
+// BenchmarkTest
+// 	Run all the kernel microbenchmarks, "reps" samples each.  Called
+//	from main for "nachos -B <reps>"; put -A before -B to benchmark
+//	a particular scheduling algorithm.
+//----------------------------------------------------------------------
+
+void
+BenchmarkTest(int reps)
+{
+    ASSERT(reps > 0);
+    benchTicks = new double[reps];
+    benchNs = new double[reps];
+    benchPing = new Semaphore("bench ping", 0);
+    benchPong = new Semaphore("bench pong", 0);
+    benchExit = new Semaphore("bench exit", 0);
+    benchChurnDone = new Semaphore("bench churn", 0);
+
+    printf("# kernel microbenchmarks: reps=%d schedulingAlgo=%d\n", reps, schedulingAlgo);
+    BenchYield(reps);
+    BenchSemaphore(reps);
+    BenchForkFinish(reps);
+    BenchInterrupts(reps);
+    BenchSleep(reps);
+    BenchReadyQueue(reps);
+
+    delete benchChurnDone;
+    delete benchExit;
+    delete benchPong;
+    delete benchPing;
+    delete [] benchNs;
+    delete [] benchTicks;
+}
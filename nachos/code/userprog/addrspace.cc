@@ -18,6 +18,7 @@
 #include "copyright.h"
 #include "system.h"
 #include "addrspace.h"
+#include "syscall.h"
 
 //----------------------------------------------------------------------
 // SwapHeader
@@ -41,101 +42,607 @@ SwapHeader (NoffHeader *noffH)
 	noffH->uninitData.inFileAddr = WordToHost(noffH->uninitData.inFileAddr);
 }
 
-void
-CheckDirtyAndBackup(int page)
+//----------------------------------------------------------------------
+// FindFrameMapper
+// 	Search the page tables of the live processes for a valid entry,
+//	other than "except", that maps physical page "page".  Used for
+//	copy-on-write frames, which physicalPageMap records only one
+//	mapper of.  Returns the entry and sets *pid, or returns NULL.
+//----------------------------------------------------------------------
+
+static TranslationEntry *
+FindFrameMapper(int page, TranslationEntry *except, int *pid)
+{
+    PageTable *table;
+    TranslationEntry *entry;
+    unsigned i, vpn;
+
+    for (i = 0; i < thread_index; i++) {
+        if (exitThreadArray[i] || (threadArray[i] == NULL) || (threadArray[i]->space == NULL))
+            continue;
+        table = threadArray[i]->space->GetPageTable();
+        for (vpn = 0; (entry = table->Next(&vpn)) != NULL; vpn++) {
+            if (entry->valid && (entry->physicalPage == page) && (entry != except)) {
+                *pid = i;
+                return entry;
+            }
+        }
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// FrameIsEvictable
+// 	TRUE if the replacement algorithms may pick physical page "page":
+//	it must be mapped, not belong to a shared memory region, and not
+//	be "avoid".
+//----------------------------------------------------------------------
+
+static bool
+FrameIsEvictable(int page, int avoid)
 {
-    char *backup = NULL;
     TranslationEntry *entry;
-    int i, thread_id;
 
+    if ((page < 0) || (page == avoid)) return FALSE;
     entry = machine->physicalPageMap[page].entry;
-    thread_id = machine->physicalPageMap[page].thread_id;
-    //ASSERT(exitThreadArray[thread_id]);
+    return ((entry != NULL) && !entry->shared);
+}
+
+//----------------------------------------------------------------------
+// SwapOutAndInvalidate
+// 	Evict "entry" of process "thread_id" from physical page "page",
+//	writing the contents back if the page is dirty: to the file for
+//	a page of a mapped file, otherwise to the swap area.  A clean page
+//	is either unchanged since it was read from its swap slot or file,
+//	or has never been written and comes from the executable.
+//
+//	A slot shared with a forked process is never overwritten; the
+//	page gets a slot of its own instead.
+//----------------------------------------------------------------------
+
+static int pageOutTicks;	// Latency of the page-outs done while
+				// finding a free frame
+static int pageWaitTicks;	// Time the faulting thread must also wait
+				// that is not new disk transfers
+static int nextAsid = 1;	// TLB tag of the next address space
+
+static int
+WriteMappedPage(int page, TranslationEntry *entry)
+{
+    char *name = mmapCache->FileOf(page);
+    int offset = mmapCache->OffsetOf(page), length;
+    OpenFile *file;
+
+    ASSERT(name != NULL);
+    file = fileSystem->Open(name);
+    ASSERT(file != NULL);
+    length = file->Length();
+    if (offset < length)		// the file is not extended
+        file->WriteAt(&machine->mainMemory[page * PageSize], min(PageSize, length - offset), offset);
+    delete file;
+    DEBUG('k', "Wrote page %d back to offset %d of %s\n", page, offset, name);
+    stats->numMappedPagesWritten++;
+    entry->dirty = FALSE;
+    return PageLoadTime;
+}
+
+static int
+WriteToSwap(int page, TranslationEntry *entry)
+{
+    if (entry->mapped)
+        return WriteMappedPage(page, entry);
+    if ((entry->swapSlot != -1) && swapSpace->IsShared(entry->swapSlot)) {
+        swapSpace->Free(entry->swapSlot);
+        entry->swapSlot = -1;
+    }
+    if (entry->swapSlot == -1) {
+        entry->swapSlot = swapSpace->Allocate();
+        ASSERT(entry->swapSlot != -1);		// out of swap
+    }
+    entry->dirty = FALSE;
+    return swapSpace->PageOut(entry->swapSlot, &machine->mainMemory[page * PageSize]);
+}
+
+static void
+DropPrefetched(TranslationEntry *entry)
+{
+    if (entry->prefetched) {		// brought in for nothing
+        stats->numPrefetchWasted++;
+        if (entry->prepaged) stats->numPrepageWasted++;
+    }
+    entry->prefetched = entry->prepaged = FALSE;
+}
+
+static void
+SwapOutAndInvalidate(int page, int thread_id, TranslationEntry *entry)
+{
     DEBUG('k', "page: %d, entry page: %d\n", page, entry->physicalPage);
     ASSERT(page == entry->physicalPage);
 
-    if (entry->dirty && !exitThreadArray[thread_id]) {
-        backup = threadArray[thread_id]->space->GetBackup();
-        for (i = 0; i < PageSize; i++)
-            backup[entry->virtualPage * PageSize + i] = machine->mainMemory[page * PageSize + i];
-        entry->backup = TRUE;
-    }
+    if (tlbManager != NULL) tlbManager->Invalidate(entry);
+    if (entry->dirty && (entry->mapped || !exitThreadArray[thread_id]))
+        pageOutTicks += WriteToSwap(page, entry);
+    DropPrefetched(entry);
     entry->physicalPage = -1;
     entry->valid = FALSE;
+    entry->cow = FALSE;		// will come back as a private copy
+    entry->readOnly = FALSE;
 }
 
-unsigned
-getNewPage (int avoid)
+void
+CheckDirtyAndBackup(int page)
 {
-    int page = avoid;
- 
-    stats->numPageFaults++;
+    TranslationEntry *entry;
+    int thread_id;
+
+    entry = machine->physicalPageMap[page].entry;
+    thread_id = machine->physicalPageMap[page].thread_id;
+    if (entry == NULL) return;		// nobody maps it any more
+
+    if (machine->physicalPageMap[page].refCount > 1) {
+        // Copy-on-write frame: every mapper loses it
+        while ((entry = FindFrameMapper(page, NULL, &thread_id)) != NULL)
+            SwapOutAndInvalidate(page, thread_id, entry);
+    }
+    else SwapOutAndInvalidate(page, thread_id, entry);
+    machine->physicalPageMap[page].entry = NULL;
+    machine->physicalPageMap[page].refCount = 0;
+    machine->fifoQueue->Remove(page);	// put back by its next user
+    machine->lruList->Remove(page);
+    textCache->Remove(page);
+    mmapCache->Remove(page);
+}
+
+//----------------------------------------------------------------------
+// TouchFrame
+// 	Record a use of physical page "page" by the kernel, for the LRU
+//	and WSCLOCK algos (uses by the program are recorded by
+//	Machine::Translate).
+//----------------------------------------------------------------------
+
+static void
+TouchFrame(int page)
+{
+    if (pageReplacementAlgo == LRU)
+        machine->lruList->Append(page);
+    machine->physicalPageMap[page].lastUse = currentThread->GetInstructionCount();
+}
+
+static bool memoryOvercommitted;	// Set when the working sets of the
+					// running processes do not fit
+
+//----------------------------------------------------------------------
+// ReleaseFrame
+// 	Return physical page "page", which no page table maps any more,
+//	to the free list.
+//----------------------------------------------------------------------
+
+static void
+ReleaseFrame(int page)
+{
+    machine->physicalPageMap[page].thread_id = -1;
+    machine->physicalPageMap[page].entry = NULL;
+    machine->physicalPageMap[page].refCount = 0;
+    machine->physicalPageMap[page].refBit = 0;
+    machine->fifoQueue->Remove(page);
+    machine->lruList->Remove(page);
+    textCache->Remove(page);
+    mmapCache->Remove(page);
+    machine->freeFrames[machine->numFreeFrames++] = page;
+    numPagesAllocated--;
+}
+
+//----------------------------------------------------------------------
+// DropFrameMapping
+// 	Page table entry "entry" no longer maps physical page "page".
+//	Release the page if that was its last mapper, or else make sure
+//	physicalPageMap records one of the others.  Returns TRUE if the
+//	page was released.
+//----------------------------------------------------------------------
+
+static bool
+DropFrameMapping(int page, TranslationEntry *entry)
+{
+    TranslationEntry *other;
+    int pid;
+
+    if (--machine->physicalPageMap[page].refCount == 0) {
+        ReleaseFrame(page);
+        return TRUE;
+    }
+    if (machine->physicalPageMap[page].entry == entry) {
+        other = FindFrameMapper(page, entry, &pid);
+        machine->physicalPageMap[page].entry = other;
+        machine->physicalPageMap[page].thread_id = (other != NULL) ? pid : -1;
+    }
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// WorkingSetVictim
+// 	The WSCLOCK algo.  Sweep the clock hand over the physical pages:
+//	a referenced page is in the working set of its owner, so clear
+//	its reference bit and note the owner's virtual time; a page not
+//	used for more than WorkingSetWindow instructions of its owner is
+//	outside the working set, and is the victim.
+//
+//	If a whole sweep finds every page in some working set, memory is
+//	overcommitted: evict the least recently used page anyway and let
+//	HandlePageFault deactivate the faulting process.
+//----------------------------------------------------------------------
+
+static int
+WorkingSetVictim(int avoid)
+{
+    PhysicalPageMap *map;
+    int i, age, oldest = -1, oldestAge = -1;
+
+    for (i = 0; i < NumPhysPages; i++) {
+        clockHand = (clockHand + 1)%NumPhysPages;
+        map = &machine->physicalPageMap[clockHand];
+        if (!FrameIsEvictable(clockHand, avoid))
+            continue;
+        if (map->refBit) {
+            map->refBit = 0;
+            map->lastUse = threadArray[map->thread_id]->GetInstructionCount();
+            continue;
+        }
+        age = threadArray[map->thread_id]->GetInstructionCount() - map->lastUse;
+        if (age > WorkingSetWindow) return clockHand;
+        if (age > oldestAge) {
+            oldest = clockHand;
+            oldestAge = age;
+        }
+    }
+    memoryOvercommitted = TRUE;
+    if (oldest == -1) {			// everything was referenced
+        do clockHand = (clockHand + 1)%NumPhysPages;
+        while (!FrameIsEvictable(clockHand, avoid));
+        oldest = clockHand;
+    }
+    return oldest;
+}
+
+//----------------------------------------------------------------------
+// UnreferencedVictim
+// 	The PFF algo sizes the resident sets at fault time (see
+//	HandlePageFault), so it only needs a victim when memory is full.
+//	Take the next page after the clock hand whose reference bit is
+//	clear, without clearing any bits: PFF reads them.
+//----------------------------------------------------------------------
+
+static int
+UnreferencedVictim(int avoid)
+{
+    int i, first = -1;
+
+    for (i = 0; i < NumPhysPages; i++) {
+        clockHand = (clockHand + 1)%NumPhysPages;
+        if (!FrameIsEvictable(clockHand, avoid))
+            continue;
+        if (!machine->physicalPageMap[clockHand].refBit)
+            return clockHand;
+        if (first == -1) first = clockHand;
+    }
+    clockHand = first;
+    return first;
+}
+
+//----------------------------------------------------------------------
+// ActiveProcessCount
+// 	Return the number of live processes not deactivated by load
+//	control.
+//----------------------------------------------------------------------
+
+static int
+ActiveProcessCount()
+{
+    int count = 0;
+
+    for (unsigned i = 0; i < thread_index; i++)
+        if (!exitThreadArray[i] && (threadArray[i] != NULL) && (threadArray[i]->space != NULL)
+                        && !threadArray[i]->space->IsSuspended())
+            count++;
+    return count;
+}
+
+//----------------------------------------------------------------------
+// EnhancedClockVictim
+// 	The ENHANCED_CLOCK algo.  Frames fall in four classes by their
+//	(referenced, dirty) bits, and the hand looks for the best one, an
+//	unreferenced clean frame, for up to three laps:
+//
+//	  1. Take the first unreferenced clean frame, leaving the
+//	     reference bits alone.
+//	  2. The same, but clear the reference bits as the hand passes.
+//	  3. Take the first unreferenced frame, clean or not.
+//
+//	In the first two laps, each unreferenced dirty frame the hand
+//	passes is written back in the background (CleanFrame), so that
+//	it can be taken as a clean frame later.  The faulting thread
+//	waits only for a write-back it cannot avoid.
+//----------------------------------------------------------------------
+
+static void
+CleanFrame(int page)
+{
+    PhysicalPageMap *map = &machine->physicalPageMap[page];
+
+    if (map->refCount > 1) return;	// copy-on-write: left to eviction
+    DEBUG('k', "Cleaning page %d in the background\n", page);
+    map->cleanDoneAt = stats->totalTicks + swapSpace->Enqueue(WriteToSwap(page, map->entry));
+    stats->numPagesCleanedAsync++;
+}
+
+static int
+EnhancedClockVictim(int avoid)
+{
+    PhysicalPageMap *map;
+    int i, lap;
+
+    for (lap = 0; lap < 3; lap++) {
+        for (i = 0; i < NumPhysPages; i++) {
+            clockHand = (clockHand + 1)%NumPhysPages;
+            if (!FrameIsEvictable(clockHand, avoid))
+                continue;
+            map = &machine->physicalPageMap[clockHand];
+            if (map->refBit) {		// second chance
+                if (lap > 0) map->refBit = 0;
+                continue;
+            }
+            if (lap == 2) {		// no luck: pay for what is left
+                if (map->cleanDoneAt > stats->totalTicks)	// already queued
+                    pageWaitTicks += map->cleanDoneAt - stats->totalTicks;
+                return clockHand;
+            }
+            if (tlbManager != NULL) tlbManager->Sync(map->entry);
+            if (map->entry->dirty) CleanFrame(clockHand);
+            else if (map->cleanDoneAt <= stats->totalTicks) return clockHand;
+        }
+    }
+    ASSERT(FALSE);			// nothing evictable
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// ChooseVictim
+// 	Run the page replacement algorithm to pick a mapped page to evict,
+//	never "avoid" or a shared memory page.
+//----------------------------------------------------------------------
+
+static int
+ChooseVictim(int avoid)
+{
+    int page;
+
     switch (pageReplacementAlgo) {
         case NONE:
-            ASSERT(numPagesAllocated <= NumPhysPages)
-            numPagesAllocated++;
-            return numPagesAllocated - 1;
+            ASSERT(FALSE);		// out of memory, and nothing to replace
         case RANDOM:
-            if (numPagesAllocated == NumPhysPages) {
-                while(page == avoid || machine->physicalPageMap[page].entry->shared == TRUE)
-                    page = Random() % NumPhysPages;
-                DEBUG('k', "Replacing page %d\n", page);
-                CheckDirtyAndBackup(page);
-                return page;
-            }
-            numPagesAllocated++;
-            return numPagesAllocated - 1;
+            do {
+                page = Random() % NumPhysPages;
+            } while (!FrameIsEvictable(page, avoid));
+            return page;
         case FIFO:
-	    if (numPagesAllocated == NumPhysPages) {
-                page = machine->fifoQueue->Remove(); 
-                if (page == avoid) {
-                    int temp = page;
-                    page = machine->fifoQueue->Remove();
-                    machine->fifoQueue->Prepend(temp);
-                }
-                DEBUG('k', "Replacing page %d\n", page);
-                CheckDirtyAndBackup(page);
-                return page;
-            }
-            numPagesAllocated++;
-            return numPagesAllocated - 1;
+            return machine->fifoQueue->Victim(FrameIsEvictable, avoid);
         case LRU:
-            if (numPagesAllocated == NumPhysPages) {
-                int min_access = stats->totalTicks;
-                for (int i = 0; i < NumPhysPages; i++) {
-                    if (machine->physicalPageMap[i].last_access <= min_access && machine->physicalPageMap[i].entry->shared == FALSE && i != avoid) {
-                        page = i;
-                        min_access = machine->physicalPageMap[i].last_access;
-                    }
-                }
-                DEBUG('k', "Replacing page %d\n", page);
-                CheckDirtyAndBackup(page);
-                return page;
-            }
-            numPagesAllocated++;
-            return numPagesAllocated - 1;
+            return machine->lruList->Victim(FrameIsEvictable, avoid);
         case LRU_CLOCK:
-            if (numPagesAllocated == NumPhysPages) {
-                clockHand = (clockHand + 1)%NumPhysPages;
-                while(1){
-                    if (machine->physicalPageMap[clockHand].refBit == 0 && machine->physicalPageMap[clockHand].entry->shared == FALSE && clockHand != avoid) {
-                        machine->physicalPageMap[clockHand].refBit = 1;
-                        DEBUG('k', "Replacing page %d\n", clockHand);
-                        CheckDirtyAndBackup(clockHand);
-                        return clockHand;
-                    } 
-                    else if (machine->physicalPageMap[clockHand].refBit == 1 && machine->physicalPageMap[clockHand].entry->shared == FALSE) {
-                        machine->physicalPageMap[clockHand].refBit = 0;
-                    }
-                    clockHand = (clockHand + 1)%NumPhysPages;
+            clockHand = (clockHand + 1)%NumPhysPages;
+            while(1){
+                if (machine->physicalPageMap[clockHand].refBit == 0 && FrameIsEvictable(clockHand, avoid)) {
+                    machine->physicalPageMap[clockHand].refBit = 1;
+                    return clockHand;
+                } 
+                else if (machine->physicalPageMap[clockHand].refBit == 1 && FrameIsEvictable(clockHand, -1)) {
+                    machine->physicalPageMap[clockHand].refBit = 0;
                 }
+                clockHand = (clockHand + 1)%NumPhysPages;
             }
-            machine->physicalPageMap[numPagesAllocated].refBit = 1;
-            numPagesAllocated++;
-            return numPagesAllocated - 1;
+        case WSCLOCK:
+            return WorkingSetVictim(avoid);
+        case PFF:
+            return UnreferencedVictim(avoid);
+        case ENHANCED_CLOCK:
+            return EnhancedClockVictim(avoid);
         default:
             ASSERT(0);
     }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// Pageout daemon
+// 	With -O low high, frames are evicted ahead of demand so that a
+//	page fault normally finds a clean free frame and pays for one
+//	page-in only.  Whenever a fault leaves fewer than "low" free
+//	frames, the daemon runs the replacement algorithm and frees
+//	victims until there are "high" free frames again.  Clean victims
+//	are freed at once; a dirty one is written to swap first, and the
+//	daemon continues when that write completes.
+//
+//	The daemon runs from the disk interrupt, as the completion
+//	handler of its own writes, rather than as a thread of its own:
+//	it never has to block, and it does not disturb the thread
+//	accounting of the batch.
+//----------------------------------------------------------------------
+
+static bool pageoutActive = FALSE;	// Is the daemon between runs?
+
+static void
+PageoutDaemon(int dummy)
+{
+    int page, savedTicks = pageOutTicks;
+
+    while (machine->numFreeFrames < pageoutHigh) {
+        page = ChooseVictim(-1);
+        DEBUG('k', "Pageout daemon freeing page %d\n", page);
+        pageOutTicks = 0;
+        CheckDirtyAndBackup(page);
+        ReleaseFrame(page);
+        stats->numPagesCleaned++;
+        if (pageOutTicks > 0) {		// wait for the write
+            interrupt->Schedule(PageoutDaemon, 0, swapSpace->Enqueue(pageOutTicks), DiskInt);
+            pageOutTicks = savedTicks;
+            return;
+        }
+    }
+    pageOutTicks = savedTicks;
+    pageoutActive = FALSE;
+}
+
+static void
+WakePageoutDaemon()
+{
+    if ((pageoutLow > 0) && !pageoutActive && (pageReplacementAlgo != NONE)
+                        && (machine->numFreeFrames < pageoutLow)) {
+        pageoutActive = TRUE;
+        interrupt->Schedule(PageoutDaemon, 0, 1, DiskInt);
+    }
+}
+
+//----------------------------------------------------------------------
+// Page merging daemon
+// 	With -M budget, identical private frames are merged into one
+//	frame, shared copy-on-write; the first write to it gives the
+//	writer its copy back (HandleCopyOnWrite).  Forked children, and
+//	batches running the same program, hold many such frames, zeroed
+//	stack and bss pages above all.
+//
+//	Every MergeInterval ticks, the daemon hashes as many frames as
+//	its budget pays for, going round physical memory.  A table
+//	indexed by the hash remembers the last frame seen with each
+//	value; a frame whose contents really match that one's is merged
+//	into it.  The table is only a hint, so it needs no maintenance
+//	when frames change or are freed: everything is checked again
+//	before merging.
+//
+//	Like the pageout daemon, it runs from an interrupt handler, so
+//	it takes no time from the threads; it stops when no frames are
+//	allocated, and the next allocation restarts it.
+//----------------------------------------------------------------------
+
+#define MergeBuckets	256
+
+static bool mergeActive = FALSE;	// Is the daemon scheduled?
+static int mergeHand = 0;		// Next frame to look at
+static int mergeHint[MergeBuckets];	// Last frame hashed to each bucket
+static unsigned mergeHintKey[MergeBuckets];	// and its full hash
+
+static unsigned
+HashFrame(int page)
+{
+    unsigned *words = (unsigned *)&machine->mainMemory[page * PageSize];
+    unsigned h = 2166136261U;
+
+    for (unsigned i = 0; i < PageSize / sizeof(unsigned); i++)
+        h = (h ^ words[i]) * 16777619U;
+    return h;
+}
+
+static bool
+FrameIsMergeable(int page)
+{
+    PhysicalPageMap *map = &machine->physicalPageMap[page];
+
+    return ((map->entry != NULL) && map->entry->valid && !map->entry->shared
+                && !map->entry->mapped && (!map->entry->readOnly || map->entry->cow)
+                && (textCache->FileOf(page) == NULL) && (map->cleanDoneAt <= stats->totalTicks));
+}
+
+static void
+MergeFrame(int page, int target)
+{
+    TranslationEntry *entry = machine->physicalPageMap[page].entry, *other;
+
+    ASSERT(machine->physicalPageMap[page].refCount == 1);
+    DEBUG('k', "Merging physical page %d into %d\n", page, target);
+    if (machine->physicalPageMap[target].refCount == 1) {	// private until now
+        other = machine->physicalPageMap[target].entry;
+        if (tlbManager != NULL) tlbManager->Invalidate(other);
+        other->cow = TRUE;
+        other->readOnly = TRUE;
+    }
+    if (tlbManager != NULL) tlbManager->Invalidate(entry);
+    entry->physicalPage = target;
+    entry->cow = TRUE;
+    entry->readOnly = TRUE;
+    machine->physicalPageMap[target].refCount++;
+    ReleaseFrame(page);
+    stats->numPagesMerged++;
+}
+
+static void
+MergeDaemon(int dummy)
+{
+    int n, spent = 0, page, target, bucket;
+    unsigned key;
+
+    for (n = 0; (n < NumPhysPages) && (spent + MergePageTime <= mergeBudget); n++) {
+        page = mergeHand;
+        mergeHand = (mergeHand + 1)%NumPhysPages;
+        if (!FrameIsMergeable(page))
+            continue;
+        spent += MergePageTime;
+        stats->numPagesScanned++;
+        key = HashFrame(page);
+        bucket = key % MergeBuckets;
+        target = mergeHint[bucket];
+        if ((target == -1) || (target == page) || (mergeHintKey[bucket] != key)
+                        || !FrameIsMergeable(target)
+                        || bcmp(&machine->mainMemory[page * PageSize],
+                                &machine->mainMemory[target * PageSize], PageSize)) {
+            mergeHint[bucket] = page;
+            mergeHintKey[bucket] = key;
+        }
+        else if (machine->physicalPageMap[page].refCount == 1)
+            MergeFrame(page, target);
+        else if (machine->physicalPageMap[target].refCount == 1) {
+            MergeFrame(target, page);
+            mergeHint[bucket] = page;
+        }
+    }
+    if (numPagesAllocated > 0)
+        interrupt->Schedule(MergeDaemon, 0, MergeInterval, TimerInt);
+    else mergeActive = FALSE;
+}
+
+static void
+WakeMergeDaemon()
+{
+    if ((mergeBudget > 0) && !mergeActive) {
+        for (int i = 0; i < MergeBuckets; i++)
+            mergeHint[i] = -1;
+        mergeActive = TRUE;
+        interrupt->Schedule(MergeDaemon, 0, MergeInterval, TimerInt);
+    }
+}
+
+//----------------------------------------------------------------------
+// getNewPage
+// 	Return a physical page for the caller to map.  A free page is
+//	used if there is one; only when memory is full does the page
+//	replacement algorithm pick a victim and evict it on the spot.
+//----------------------------------------------------------------------
+
+unsigned
+getNewPage (int avoid)
+{
+    int page;
+ 
+    if (machine->numFreeFrames > 0) {
+        page = machine->freeFrames[--machine->numFreeFrames];
+        machine->physicalPageMap[page].refBit = 1;
+        numPagesAllocated++;
+        WakePageoutDaemon();
+        WakeMergeDaemon();
+        return page;
+    }
+    WakePageoutDaemon();
+    page = ChooseVictim(avoid);
+    DEBUG('k', "Replacing page %d\n", page);
+    CheckDirtyAndBackup(page);
+    return page;
 }
 
 void
@@ -143,6 +650,8 @@ SetPhysicalMap(int page, int pid, TranslationEntry *entry)
 {
     machine->physicalPageMap[page].thread_id = pid;
     machine->physicalPageMap[page].entry = entry;
+    machine->physicalPageMap[page].refCount = 1;
+    machine->physicalPageMap[page].cleanDoneAt = 0;
 }
 //----------------------------------------------------------------------
 // ProcessAddrSpace::ProcessAddrSpace
@@ -167,7 +676,9 @@ ProcessAddrSpace::ProcessAddrSpace(OpenFile *Executable, char *Filename)
     unsigned int pageFrame;
 
     executable = Executable;
-    filename = Filename;
+    filename = new char[strlen(Filename) + 1];	// the caller's may be on
+    strcpy(filename, Filename);			// an exiting thread's stack
+    asid = nextAsid++;
 
     executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
     if ((noffH.noffMagic != NOFFMAGIC) && 
@@ -181,10 +692,20 @@ ProcessAddrSpace::ProcessAddrSpace(OpenFile *Executable, char *Filename)
 						// to leave room for the stack
     numPagesInVM = divRoundUp(size, PageSize);
     size = numPagesInVM * PageSize;
+    shmBase = numPagesInVM;		// shared memory goes above the stack
+    numPagesInVM += ShmRegionPages;
+    for (i = 0; i < MAX_SHM_SEGMENTS; i++)
+        shmAttachedAt[i] = -1;
 
-    backup = new char[size];
+    rasStart = rasEnd = 0;
+    lastFaultTime = 0;
+    suspendedUntil = 0;
+    seqNextVpn = readAhead = 0;
+    workingSet = (maxPrepage > 0) ? new unsigned[maxPrepage] : NULL;
+    workingSetSize = 0;
+    prepagePending = FALSE;
     if (pageReplacementAlgo == NONE)
-        ASSERT(numPagesInVM+numPagesAllocated <= NumPhysPages);		// check we're not trying
+        ASSERT(shmBase+numPagesAllocated <= NumPhysPages);		// check we're not trying
 										// to run anything too big --
 										// at least until we have
 										// virtual memory
@@ -192,93 +713,140 @@ ProcessAddrSpace::ProcessAddrSpace(OpenFile *Executable, char *Filename)
     DEBUG('k', "Initializing address space, num pages %d, size %d\n", 
 					numPagesInVM, size);
 // first, set up the translation 
-    NachOSpageTable = new TranslationEntry[numPagesInVM];
-    for (i = 0; i < numPagesInVM; i++) {
-	NachOSpageTable[i].virtualPage = i;
-	NachOSpageTable[i].physicalPage = -1;
-	NachOSpageTable[i].valid = FALSE;
-	NachOSpageTable[i].use = FALSE;
-	NachOSpageTable[i].dirty = FALSE;
-        NachOSpageTable[i].shared = FALSE;
-        NachOSpageTable[i].backup = FALSE;
-	NachOSpageTable[i].readOnly = FALSE;  // if the code segment was entirely on 
-					// a separate page, we could set its 
-					// pages to be read-only
+    NachOSpageTable = new PageTable(numPagesInVM);	// entries are created
+							// invalid as they are used
+    for (i = 0; i < MAX_MMAPS; i++)
+        mappings[i].name = NULL;
+
+    // Code pages that other processes running this executable already
+    // have in memory need not even be faulted in
+    for (i = 0; i < shmBase; i++) {
+        if (IsTextPage(i) && ((pageFrame = textCache->Lookup(filename, TextOffset(i))) != (unsigned)-1))
+            MapCachedPage(i, pageFrame);
     }
 }
 
 //----------------------------------------------------------------------
 // ProcessAddrSpace::ProcessAddrSpace (ProcessAddrSpace*) is called by a forked thread.
 //      We need to duplicate the address space of the parent.
+//
+//      Resident pages are not copied: parent and child share the frame
+//      copy-on-write.  Both entries are made read-only, and the first
+//      write through either one raises a ReadOnlyException that gives
+//      the writer its own copy (see HandleCopyOnWrite).  Swap slots are
+//      shared the same way.
 //----------------------------------------------------------------------
 
 ProcessAddrSpace::ProcessAddrSpace(ProcessAddrSpace *parentSpace, int pid)
 {
     numPagesInVM = parentSpace->GetNumPages();
-    unsigned i, k, size = numPagesInVM * PageSize;
-    unsigned startAddrParent, startAddrChild, unallocated;
-    char *parentBackup = parentSpace->GetBackup();
+    unsigned i, size = numPagesInVM * PageSize;
+    int frame;
 
-    filename = parentSpace->filename;
+    filename = new char[strlen(parentSpace->filename) + 1];
+    strcpy(filename, parentSpace->filename);	// the parent may exit first
+    asid = nextAsid++;
     executable = fileSystem->Open(filename);
     if (executable == NULL) {
 	printf("Unable to open file %s\n", filename);
 	return;
     }
     noffH = parentSpace->GetNoffHeader();
-    backup = new char[size];
-
-    if (pageReplacementAlgo == NONE)
-        ASSERT(numPagesInVM+numPagesAllocated <= NumPhysPages);                // check we're not trying
-                                                                                // to run anything too big --
-                                                                                // at least until we have
-                                                                                // virtual memory
+    rasStart = parentSpace->rasStart;
+    rasEnd = parentSpace->rasEnd;
+    lastFaultTime = 0;
+    suspendedUntil = 0;
+    seqNextVpn = readAhead = 0;
+    workingSet = (maxPrepage > 0) ? new unsigned[maxPrepage] : NULL;
+    workingSetSize = 0;			// the child has not run yet
+    prepagePending = FALSE;
+    shmBase = parentSpace->shmBase;
+    for (i = 0; i < MAX_SHM_SEGMENTS; i++) {	// inherit attached segments
+        shmAttachedAt[i] = parentSpace->shmAttachedAt[i];
+        if (shmAttachedAt[i] != -1)
+            shmTable->GetSegment(i)->numAttached++;
+    }
+    for (i = 0; i < MAX_MMAPS; i++) {		// and mapped files
+        mappings[i] = parentSpace->mappings[i];
+        if (mappings[i].name == NULL) continue;
+        mappings[i].name = new char[strlen(parentSpace->mappings[i].name) + 1];
+        strcpy(mappings[i].name, parentSpace->mappings[i].name);
+        mappings[i].file = fileSystem->Open(mappings[i].name);
+        ASSERT(mappings[i].file != NULL);
+    }
 
     DEBUG('k', "Initializing address space, num pages %d, size %d\n",
                                         numPagesInVM, size);
     // first, set up the translation
-    TranslationEntry* parentPageTable = parentSpace->GetPageTable();
-    NachOSpageTable = new TranslationEntry[numPagesInVM];
-    for (i = 0; i < numPagesInVM; i++) {
-        NachOSpageTable[i].virtualPage = i;
-        if (parentPageTable[i].shared || !parentPageTable[i].valid)
-            NachOSpageTable[i].physicalPage = parentPageTable[i].physicalPage;
-        else if (parentPageTable[i].valid) {
-            unallocated = getNewPage(parentPageTable[i].physicalPage);
-            DEBUG('k', "Copying virtual page %d to physical page %d\n", i, unallocated);
-            bzero(&machine->mainMemory[unallocated * PageSize], PageSize);
-            startAddrChild = unallocated * PageSize;
-            startAddrParent = parentPageTable[i].physicalPage * PageSize;
-            for (k = 0; k < PageSize; k++)
-               machine->mainMemory[startAddrChild + k] = machine->mainMemory[startAddrParent + k];
-            NachOSpageTable[i].physicalPage = unallocated;
-            SetPhysicalMap(unallocated, pid, &NachOSpageTable[i]);
-            machine->fifoQueue->Append(unallocated);
-            machine->physicalPageMap[parentPageTable[i].physicalPage].refBit = 1;
-            machine->physicalPageMap[parentPageTable[i].physicalPage].last_access = stats->totalTicks;
-            machine->physicalPageMap[unallocated].last_access = stats->totalTicks;
+    PageTable *parentPageTable = parentSpace->GetPageTable();
+    TranslationEntry *parent, *child;
+    NachOSpageTable = new PageTable(numPagesInVM);
+    for (i = 0; (parent = parentPageTable->Next(&i)) != NULL; i++) {
+        if (parent->valid && (tlbManager != NULL))
+            tlbManager->Invalidate(parent);	// for its dirty bit, and cow
+        child = NachOSpageTable->Entry(i);
+        child->physicalPage = parent->physicalPage;
+        if (parent->valid && IsTextPage(i))	// already read-only
+            machine->physicalPageMap[parent->physicalPage].refCount++;
+        else if (parent->valid && !parent->shared && !parent->mapped) {
+            frame = parent->physicalPage;
+            DEBUG('k', "Sharing virtual page %d in physical page %d copy-on-write\n", i, frame);
+            parent->cow = TRUE;
+            parent->readOnly = TRUE;
+            machine->physicalPageMap[frame].refCount++;
+            machine->physicalPageMap[frame].refBit = 1;
+            machine->physicalPageMap[frame].last_access = stats->totalTicks;
+            TouchFrame(frame);
         }
-        NachOSpageTable[i].valid = parentPageTable[i].valid;
-        NachOSpageTable[i].use = parentPageTable[i].use;
-        NachOSpageTable[i].dirty = parentPageTable[i].dirty;
-        NachOSpageTable[i].shared = parentPageTable[i].shared;
-        NachOSpageTable[i].backup = parentPageTable[i].backup;
-        NachOSpageTable[i].readOnly = parentPageTable[i].readOnly;  	// if the code segment was entirely on
-                                        			// a separate page, we could set its
-                                        			// pages to be read-only
+        else if (parent->valid)		// shared memory, mapped file
+            machine->physicalPageMap[parent->physicalPage].refCount++;
+        child->valid = parent->valid;
+        child->use = parent->use;
+        child->dirty = parent->dirty;
+        child->shared = parent->shared;
+        child->swapSlot = parent->swapSlot;
+        child->cow = parent->cow;
+        child->prefetched = child->prepaged = FALSE;
+        child->mapped = parent->mapped;
+        child->readOnly = parent->readOnly;
+        if (child->swapSlot != -1)
+            swapSpace->Share(child->swapSlot);
     }
-    for (i = 0; i < size; i++)
-        backup[i] = parentBackup[i];
 }
 
 //----------------------------------------------------------------------
 // ProcessAddrSpace::~ProcessAddrSpace
-// 	Dealloate an address space.  Nothing for now!
+// 	Dealloate an address space.  Frames no other process maps go
+//	back to the free list, so that the pages of a dead process do
+//	not displace live ones; frames still shared are handed over to
+//	one of the remaining mappers.  Swap slots are released too, and
+//	the changes to mapped files written back.
+//	Called with interrupts disabled, once the owner is done with it.
 //----------------------------------------------------------------------
 
 ProcessAddrSpace::~ProcessAddrSpace()
 {
-   delete NachOSpageTable;
+    TranslationEntry *entry;
+    unsigned vpn;
+    int shmid, m;
+
+    if (tlbManager != NULL) tlbManager->InvalidateAsid(asid);
+    for (shmid = 0; shmid < MAX_SHM_SEGMENTS; shmid++)
+        if (shmAttachedAt[shmid] != -1)
+            UnmapSegment(shmid);
+    for (m = 0; m < MAX_MMAPS; m++)
+        if (mappings[m].name != NULL)
+            UnmapMapping(&mappings[m]);
+    for (vpn = 0; (entry = NachOSpageTable->Next(&vpn)) != NULL; vpn++) {
+        DropPrefetched(entry);
+        if (entry->valid)
+            (void) DropFrameMapping(entry->physicalPage, entry);
+        if (entry->swapSlot != -1)
+            swapSpace->Free(entry->swapSlot);
+    }
+    delete NachOSpageTable;
+    if (workingSet != NULL) delete [] workingSet;
+    delete [] filename;
 }
 
 //----------------------------------------------------------------------
@@ -309,8 +877,8 @@ ProcessAddrSpace::InitUserCPURegisters()
    // Set the stack register to the end of the address space, where we
    // allocated the stack; but subtract off a bit, to make sure we don't
    // accidentally reference off the end!
-    machine->WriteRegister(StackReg, numPagesInVM * PageSize - 16);
-    DEBUG('k', "Initializing stack register to %d\n", numPagesInVM * PageSize - 16);
+    machine->WriteRegister(StackReg, shmBase * PageSize - 16);
+    DEBUG('k', "Initializing stack register to %d\n", shmBase * PageSize - 16);
 }
 
 //----------------------------------------------------------------------
@@ -318,11 +886,30 @@ ProcessAddrSpace::InitUserCPURegisters()
 // 	On a context switch, save any machine state, specific
 //	to this address space, that needs saving.
 //
-//	For now, nothing!
+//	With prepaging (-pp), record the resident pages referenced since
+//	the last switch, up to maxPrepage of them: the working set that
+//	Prepage brings back if the process loses it while switched out.
+//	If the process hardly ran, the previous record is kept.
 //----------------------------------------------------------------------
 
 void ProcessAddrSpace::SaveStateOnSwitch() 
-{}
+{
+    TranslationEntry *entry;
+    unsigned vpn;
+    int n = 0;
+
+    if (workingSet == NULL) return;
+    for (vpn = 0; (entry = NachOSpageTable->Next(&vpn)) != NULL; vpn++) {
+        if (!entry->valid || entry->shared)
+            continue;
+        if (tlbManager != NULL) tlbManager->Sync(entry);
+        if (!entry->use)
+            continue;
+        entry->use = FALSE;
+        if (n < maxPrepage) workingSet[n++] = vpn;
+    }
+    if (n > 0) workingSetSize = n;
+}
 
 //----------------------------------------------------------------------
 // ProcessAddrSpace::RestoreStateOnSwitch
@@ -335,7 +922,8 @@ void ProcessAddrSpace::SaveStateOnSwitch()
 void ProcessAddrSpace::RestoreStateOnSwitch() 
 {
     machine->NachOSpageTable = NachOSpageTable;
-    machine->NachOSpageTableSize = numPagesInVM;
+    machine->currentAsid = asid;	// no need to flush the TLB
+    prepagePending = (workingSetSize > 0);
 }
 
 unsigned
@@ -344,7 +932,7 @@ ProcessAddrSpace::GetNumPages()
    return numPagesInVM;
 }
 
-TranslationEntry*
+PageTable*
 ProcessAddrSpace::GetPageTable()
 {
    return NachOSpageTable;
@@ -368,93 +956,682 @@ ProcessAddrSpace::GetFilename()
     return filename;
 }
 
-char*
-ProcessAddrSpace::GetBackup()
+//----------------------------------------------------------------------
+// ProcessAddrSpace::SetAtomicSequence
+//      Called by SYScall_RasCtl to register the restartable atomic
+//      sequence used by the user level locks.
+//----------------------------------------------------------------------
+
+void
+ProcessAddrSpace::SetAtomicSequence(int start, int length)
 {
-    return backup;
+    rasStart = start;
+    rasEnd = start + length;
 }
 
+//----------------------------------------------------------------------
+// ProcessAddrSpace::RestartAtomicSequence
+//      If a thread is switched out in the middle of the registered
+//      atomic sequence, roll its program counter back to the start of
+//      the sequence, so that the sequence appears to execute atomically
+//      when the thread is resumed.
+//----------------------------------------------------------------------
+
+void
+ProcessAddrSpace::RestartAtomicSequence(int *userRegisters)
+{
+    if ((userRegisters[PCReg] >= rasStart) && (userRegisters[PCReg] < rasEnd)) {
+        DEBUG('a', "Restarting atomic sequence at 0x%x\n", userRegisters[PCReg]);
+        userRegisters[PCReg] = rasStart;
+        userRegisters[NextPCReg] = rasStart + 4;
+    }
+}
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::AddSharedMemory
+//      Called by SYScall_ShmAllocate.  Attach a new segment of "size"
+//      bytes that no other process can look up; forked children
+//      inherit it like any attached segment.
+//----------------------------------------------------------------------
+
 int
 ProcessAddrSpace::AddSharedMemory(unsigned size)
 {
-    int i, startSharedAddr;
-    unsigned numSharedPages, unallocated;
-    TranslationEntry* pageTable;
-    char *oldBackup;
-
-    numSharedPages =  divRoundUp(size, PageSize);
-    size = numSharedPages * PageSize;
-    pageTable = NachOSpageTable;
-    NachOSpageTable = new TranslationEntry[numPagesInVM + numSharedPages];
-    oldBackup = backup;
-    backup = new char[(numPagesInVM + numSharedPages) * PageSize];
-     
-    for (i = 0; i < numPagesInVM; i++) {
-        NachOSpageTable[i].virtualPage = i;
-        NachOSpageTable[i].physicalPage = pageTable[i].physicalPage;
-        NachOSpageTable[i].valid = pageTable[i].valid;
-        NachOSpageTable[i].use = pageTable[i].use;
-        NachOSpageTable[i].dirty = pageTable[i].dirty;
-        NachOSpageTable[i].shared = pageTable[i].shared;
-        NachOSpageTable[i].readOnly = pageTable[i].readOnly;
-        NachOSpageTable[i].backup = pageTable[i].backup;
-
-        if (pageTable[i].valid)
-            SetPhysicalMap(pageTable[i].physicalPage, currentThread->GetPID(), &NachOSpageTable[i]);
-    }
-
-    for (i = numPagesInVM; i < numPagesInVM + numSharedPages; i++) {
-        unallocated = getNewPage(-1);
-        DEBUG('k', "allocating shared page %d to physical page %d\n", i, unallocated);
-        bzero(&machine->mainMemory[unallocated * PageSize], PageSize);
-        NachOSpageTable[i].virtualPage = i;
-        NachOSpageTable[i].physicalPage = unallocated;
-        NachOSpageTable[i].valid = TRUE;
-        NachOSpageTable[i].use = FALSE;
-        NachOSpageTable[i].dirty = FALSE;
-        NachOSpageTable[i].shared = TRUE;
-        NachOSpageTable[i].readOnly = FALSE;
-        NachOSpageTable[i].backup = FALSE;
-        SetPhysicalMap(unallocated, currentThread->GetPID(), &NachOSpageTable[i]);
-        machine->physicalPageMap[unallocated].last_access = stats->totalTicks;
-    }
-
-    for (i = 0; i < numPagesInVM * PageSize; i++)
-        backup[i] = oldBackup[i];
-
-    DEBUG('k', "Initializing shared address space, num pages %d, size %d\n",
-                                        numSharedPages, size);
-    delete pageTable;
-    delete oldBackup;
-    startSharedAddr = numPagesInVM * PageSize;
-    numPagesInVM += numSharedPages;
-    machine->NachOSpageTable = NachOSpageTable;
-    machine->NachOSpageTableSize = numPagesInVM;
-    return startSharedAddr;
+    int shmid = shmTable->Get(SHM_PRIVATE, size), vaddr;
+
+    if (shmid == -1) return -1;
+    vaddr = AttachShared(shmid, 0);
+    if (vaddr == -1)			// nobody else can find it
+        shmTable->Remove(shmid);
+    return vaddr;
 }
 
-void
-ProcessAddrSpace::HandlePageFault(int vaddr)
+//----------------------------------------------------------------------
+// ProcessAddrSpace::AttachShared
+//      Called by SYScall_ShmAttach.  Map segment "shmid" into the shared
+//      memory region, at "vaddr" if it is not 0, or else at the lowest
+//      address with room for it.  The first process to attach the
+//      segment gets it zero-filled frames.  Returns the address, or -1
+//      if the segment does not exist, is attached already, or does not
+//      fit there.
+//----------------------------------------------------------------------
+
+int
+ProcessAddrSpace::AttachShared(int shmid, int vaddr)
 {
+    SharedSegment *seg = shmTable->GetSegment(shmid);
+    IntStatus oldLevel;
+    TranslationEntry *entry;
     unsigned vpn, i;
-    unsigned unallocated = getNewPage(-1);
-
-    vpn = vaddr/PageSize;
-    DEBUG('k', "Copying virtual page %d to physical page %d ", vpn, unallocated);
-    bzero(&machine->mainMemory[unallocated * PageSize], PageSize);
-    if (NachOSpageTable[vpn].backup) {
-        DEBUG('k',"from backup\n");
-        for (i = 0; i < PageSize; i++)
-            machine->mainMemory[i + unallocated * PageSize] = backup[i + vpn * PageSize];
-    } 
+    int frame;
+
+    if ((seg == NULL) || (shmAttachedAt[shmid] != -1)) return -1;
+    if (vaddr != 0) {
+        vpn = (unsigned)vaddr / PageSize;
+        if (((unsigned)vaddr % PageSize != 0) || (vpn < shmBase)
+                        || !RegionIsFree(vpn, seg->numPages))
+            return -1;
+    }
     else {
-        DEBUG('k',"from executable\n");
-        executable->ReadAt(&(machine->mainMemory[unallocated * PageSize]),
-                        PageSize, noffH.code.inFileAddr + vpn * PageSize);
-    }
-    NachOSpageTable[vpn].physicalPage = unallocated;
-    NachOSpageTable[vpn].valid = TRUE;
-    machine->fifoQueue->Append(unallocated);
-    SetPhysicalMap(unallocated, currentThread->GetPID(), &NachOSpageTable[vpn]);
-    machine->physicalPageMap[unallocated].last_access = stats->totalTicks;
+        for (vpn = shmBase; vpn < numPagesInVM; vpn++)
+            if (RegionIsFree(vpn, seg->numPages)) break;
+        if (vpn == numPagesInVM) return -1;
+    }
+
+    oldLevel = interrupt->SetLevel(IntOff);
+    for (i = 0; i < (unsigned)seg->numPages; i++) {
+        entry = NachOSpageTable->Entry(vpn + i);
+        if (seg->frames[i] == -1) {
+            frame = getNewPage(-1);
+            bzero(&machine->mainMemory[frame * PageSize], PageSize);
+            SetPhysicalMap(frame, currentThread->GetPID(), entry);
+            machine->physicalPageMap[frame].last_access = stats->totalTicks;
+            seg->frames[i] = frame;
+        }
+        else machine->physicalPageMap[seg->frames[i]].refCount++;
+        entry->physicalPage = seg->frames[i];
+        entry->valid = TRUE;
+        entry->use = FALSE;
+        entry->dirty = FALSE;
+        entry->shared = TRUE;
+        entry->readOnly = FALSE;
+        entry->cow = FALSE;
+        entry->prefetched = FALSE;
+    }
+    shmAttachedAt[shmid] = vpn;
+    seg->numAttached++;
+    (void) interrupt->SetLevel(oldLevel);
+    DEBUG('k', "Attached shared segment %d at virtual page %d\n", shmid, vpn);
+    return vpn * PageSize;
+}
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::RegionIsFree
+//      TRUE if "count" pages from "vpn" fit in the address space, and
+//      no segment is attached and no file mapped there.
+//----------------------------------------------------------------------
+
+bool
+ProcessAddrSpace::RegionIsFree(unsigned vpn, int count)
+{
+    TranslationEntry *entry;
+
+    if (vpn + count > numPagesInVM) return FALSE;
+    for (int i = 0; i < count; i++) {
+        entry = NachOSpageTable->Lookup(vpn + i);
+        if ((entry != NULL) && (entry->valid || entry->mapped))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::DetachShared
+//      Called by SYScall_ShmDetach.  Unmap the segment attached at
+//      "vaddr".  Returns 0, or -1 if there is none.
+//----------------------------------------------------------------------
+
+int
+ProcessAddrSpace::DetachShared(int vaddr)
+{
+    IntStatus oldLevel;
+    int shmid;
+
+    for (shmid = 0; shmid < MAX_SHM_SEGMENTS; shmid++)
+        if ((shmAttachedAt[shmid] != -1) && (shmAttachedAt[shmid] * PageSize == vaddr))
+            break;
+    if (shmid == MAX_SHM_SEGMENTS) return -1;
+    oldLevel = interrupt->SetLevel(IntOff);
+    UnmapSegment(shmid);
+    (void) interrupt->SetLevel(oldLevel);
+    return 0;
+}
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::UnmapSegment
+//      Invalidate the pages of attached segment "shmid".  A frame stays
+//      with the other page tables mapping it; the last detach frees
+//      the frames and the segment.  Called with interrupts disabled.
+//----------------------------------------------------------------------
+
+void
+ProcessAddrSpace::UnmapSegment(int shmid)
+{
+    SharedSegment *seg = shmTable->GetSegment(shmid);
+    TranslationEntry *entry;
+    int i, frame;
+
+    for (i = 0; i < seg->numPages; i++) {
+        entry = NachOSpageTable->Entry(shmAttachedAt[shmid] + i);
+        if (tlbManager != NULL) tlbManager->Invalidate(entry);
+        frame = entry->physicalPage;
+        entry->valid = FALSE;
+        entry->shared = FALSE;
+        entry->physicalPage = -1;
+        if (DropFrameMapping(frame, entry))
+            seg->frames[i] = -1;
+    }
+    DEBUG('k', "Detached shared segment %d from virtual page %d\n", shmid, shmAttachedAt[shmid]);
+    shmAttachedAt[shmid] = -1;
+    if (--seg->numAttached == 0)
+        shmTable->Remove(shmid);
+}
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::MapFile
+//      Called by SYScall_Mmap.  Map the first "length" bytes of the file
+//      "name" at the lowest address in the shared memory region with
+//      room for them.  Nothing is read yet: the pages are marked mapped
+//      and come in on demand (see LoadPage).  Returns the address, or -1
+//      if the file cannot be opened or there is no room.
+//----------------------------------------------------------------------
+
+int
+ProcessAddrSpace::MapFile(char *name, int length)
+{
+    int m, i, numPages = divRoundUp(length, PageSize);
+    MappedFile *map;
+    OpenFile *file;
+    unsigned vpn;
+
+    for (m = 0; (m < MAX_MMAPS) && (mappings[m].name != NULL); m++);
+    if ((m == MAX_MMAPS) || (length <= 0)) return -1;
+    for (vpn = shmBase; vpn < numPagesInVM; vpn++)
+        if (RegionIsFree(vpn, numPages)) break;
+    if (vpn == numPagesInVM) return -1;
+    file = fileSystem->Open(name);
+    if (file == NULL) return -1;
+
+    map = &mappings[m];
+    map->name = new char[strlen(name) + 1];
+    strcpy(map->name, name);
+    map->file = file;
+    map->vpn = vpn;
+    map->numPages = numPages;
+    for (i = 0; i < numPages; i++)
+        NachOSpageTable->Entry(vpn + i)->mapped = TRUE;
+    DEBUG('k', "Mapped %s at virtual page %d, %d pages\n", name, vpn, numPages);
+    return vpn * PageSize;
+}
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::UnmapFile
+//      Called by SYScall_Munmap.  Unmap the file mapped at "vaddr".
+//      Returns 0, or -1 if there is none.
+//----------------------------------------------------------------------
+
+int
+ProcessAddrSpace::UnmapFile(int vaddr)
+{
+    IntStatus oldLevel;
+    int m;
+
+    for (m = 0; m < MAX_MMAPS; m++)
+        if ((mappings[m].name != NULL) && (mappings[m].vpn * PageSize == (unsigned)vaddr))
+            break;
+    if (m == MAX_MMAPS) return -1;
+    oldLevel = interrupt->SetLevel(IntOff);
+    UnmapMapping(&mappings[m]);
+    (void) interrupt->SetLevel(oldLevel);
+    return 0;
+}
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::FindMapping
+//      Return the mapping that virtual page "vpn" belongs to.
+//----------------------------------------------------------------------
+
+MappedFile *
+ProcessAddrSpace::FindMapping(unsigned vpn)
+{
+    for (int m = 0; m < MAX_MMAPS; m++)
+        if ((mappings[m].name != NULL) && (vpn >= mappings[m].vpn)
+                        && (vpn < mappings[m].vpn + mappings[m].numPages))
+            return &mappings[m];
+    ASSERT(FALSE);
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::UnmapMapping
+//      Write the pages of "map" this process changed back to the file,
+//      and unmap them.  Frames other processes map stay with them.
+//      Called with interrupts disabled.
+//----------------------------------------------------------------------
+
+void
+ProcessAddrSpace::UnmapMapping(MappedFile *map)
+{
+    TranslationEntry *entry;
+    int i;
+
+    for (i = 0; i < map->numPages; i++) {
+        entry = NachOSpageTable->Entry(map->vpn + i);
+        if (tlbManager != NULL) tlbManager->Invalidate(entry);
+        if (entry->valid) {
+            if (entry->dirty)
+                (void) WriteMappedPage(entry->physicalPage, entry);
+            (void) DropFrameMapping(entry->physicalPage, entry);
+        }
+        DropPrefetched(entry);
+        entry->physicalPage = -1;
+        entry->valid = FALSE;
+        entry->dirty = FALSE;
+        entry->mapped = FALSE;
+    }
+    DEBUG('k', "Unmapped %s from virtual page %d\n", map->name, map->vpn);
+    delete map->file;
+    delete [] map->name;
+    map->name = NULL;
+}
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::HandlePageFault
+//      Bring the page holding "vaddr" into memory (see LoadPage), and
+//      possibly some of the pages after it.  Returns the disk time of
+//      the transfers, including any page-outs needed to free frames,
+//      or -1 if "vaddr" lies in a part of the shared memory region that
+//      nothing is attached to: the program is at fault, not the kernel.
+//      "waitTicks" is set to how long the faulting thread must wait on
+//      top of that without using the disk: compressing pages, writes
+//      already queued by the cleaner, and load-control suspension.
+//      Called with interrupts disabled.
+//----------------------------------------------------------------------
+
+int
+ProcessAddrSpace::HandlePageFault(int vaddr, int *waitTicks)
+{
+    unsigned vpn = vaddr/PageSize, next;
+    unsigned now = currentThread->GetInstructionCount();
+    TranslationEntry *entry;
+    int ticks;
+
+    *waitTicks = 0;
+    if (vpn >= shmBase) {
+        entry = NachOSpageTable->Lookup(vpn);
+        if ((entry == NULL) || !entry->mapped)
+            return -1;			// detached or never attached
+    }
+    stats->numPageFaults++;
+    pageOutTicks = pageWaitTicks = 0;
+    (void) swapSpace->TakePoolTicks();	// left over from the daemons
+    memoryOvercommitted = FALSE;
+    if (pageReplacementAlgo == PFF) {
+        if (now - lastFaultTime > PFFInterval)
+            ReleaseFrames(-1, TRUE);		// shrink to the pages in use
+        else if (machine->numFreeFrames == 0)
+            memoryOvercommitted = TRUE;		// needs to grow, but cannot
+        lastFaultTime = now;
+    }
+    ticks = LoadPage(vpn, FALSE);
+    if (prepagePending) {		// first fault since switched in
+        prepagePending = FALSE;
+        ticks += Prepage();
+    }
+
+    // Bring in the next pages along with this one, while they are not
+    // resident and there is free memory for them: the rest of the
+    // cluster (-C), plus the read-ahead window if the faults of this
+    // process have been walking sequentially through its pages (-ra).
+    // Pages from the executable come in the same I/O as the first.
+    if (vpn == seqNextVpn)
+        readAhead = min(max(2 * readAhead, 1), maxReadAhead);
+    else readAhead = 0;
+    for (next = vpn + 1; (next < vpn + faultClusterSize + readAhead) && (next < numPagesInVM); next++) {
+        entry = (next < shmBase) ? NachOSpageTable->Entry(next) : NachOSpageTable->Lookup(next);
+        if ((entry == NULL) || entry->valid || ((next >= shmBase) && !entry->mapped)
+                        || (entry->swapSlot != -1) || (machine->numFreeFrames == 0))
+            break;
+        if (LoadPage(next, TRUE) > 0)
+            ticks += ClusterPageTime;
+    }
+    seqNextVpn = next;
+
+    // Load control: if the working sets do not fit, take the faulting
+    // process out of memory for a while, so that the others can run
+    // without thrashing.  Never deactivate the last active process.
+    if (memoryOvercommitted && (ActiveProcessCount() > 1)) {
+        DEBUG('k', "Deactivating process %d\n", currentThread->GetPID());
+        stats->numDeactivations++;
+        ReleaseFrames(vpn, FALSE);
+        suspendedUntil = stats->totalTicks + SuspendTime;
+        pageWaitTicks += SuspendTime;
+    }
+    *waitTicks = pageWaitTicks + swapSpace->TakePoolTicks();
+    return pageOutTicks + ticks;
+}
+
+bool
+ProcessAddrSpace::IsSuspended()
+{
+    return (suspendedUntil > stats->totalTicks);
+}
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::LoadPage
+//      Bring virtual page "vpn" into a free frame: from its file for
+//      a page of a mapped file, or else from the swap area if it was
+//      ever swapped out dirty, or else from the executable, or zero it
+//      if it holds neither code nor initialized data.  Code pages and
+//      pages of mapped files another process has in memory are shared
+//      instead.  A "prefetch" page was not asked for by the program.
+//      Returns the latency of the I/O, not counting page-outs.
+//----------------------------------------------------------------------
+
+int
+ProcessAddrSpace::LoadPage(unsigned vpn, bool prefetch)
+{
+    TranslationEntry *entry = NachOSpageTable->Entry(vpn);
+    MappedFile *map = NULL;
+    int frame, ticks, offset;
+
+    if (entry->mapped) {
+        map = FindMapping(vpn);
+        offset = (vpn - map->vpn) * PageSize;
+        frame = mmapCache->Lookup(map->name, offset);
+        if (frame != -1) stats->numMappedPageHits++;
+    }
+    else if (IsTextPage(vpn)) {
+        frame = textCache->Lookup(filename, TextOffset(vpn));
+        if (frame != -1) stats->numTextPageHits++;
+    }
+    else frame = -1;
+    if (frame != -1) {
+        DEBUG('k', "Mapping virtual page %d to cached page %d\n", vpn, frame);
+        MapCachedPage(vpn, frame);		// no I/O needed
+        entry->prefetched = prefetch;
+        entry->prepaged = FALSE;
+        if (prefetch) stats->numPagesPrefetched++;
+        return 0;
+    }
+    frame = getNewPage(-1);
+
+    DEBUG('k', "Copying virtual page %d to physical page %d ", vpn, frame);
+    bzero(&machine->mainMemory[frame * PageSize], PageSize);
+    if (entry->mapped) {			// past the end of the file stays zero
+        DEBUG('k',"from %s\n", map->name);
+        map->file->ReadAt(&machine->mainMemory[frame * PageSize], PageSize, offset);
+        mmapCache->Insert(map->name, offset, frame);
+        stats->numMappedPagesRead++;
+        ticks = PageLoadTime;
+    }
+    else if (entry->swapSlot != -1) {
+        DEBUG('k',"from swap slot %d\n", entry->swapSlot);
+        ticks = swapSpace->PageIn(entry->swapSlot, &machine->mainMemory[frame * PageSize]);
+    } 
+    else if (ReadSegment(&noffH.code, vpn, frame)
+                        + ReadSegment(&noffH.initData, vpn, frame) > 0) {
+        DEBUG('k',"from executable\n");		// a page may hold both
+        ticks = PageLoadTime;
+        if (IsTextPage(vpn)) {			// share it from now on
+            textCache->Insert(filename, TextOffset(vpn), frame);
+            entry->readOnly = TRUE;
+        }
+    }
+    else {					// bss or stack: already zeroed
+        DEBUG('k',"zero-filled\n");
+        if (!prefetch) stats->numZeroFillFaults++;
+        ticks = 0;
+    }
+    entry->physicalPage = frame;
+    entry->valid = TRUE;
+    entry->dirty = FALSE;			// same as its backing copy
+    entry->use = FALSE;
+    entry->prefetched = prefetch;
+    entry->prepaged = FALSE;
+    if (prefetch) stats->numPagesPrefetched++;
+    machine->fifoQueue->Append(frame);
+    SetPhysicalMap(frame, currentThread->GetPID(), entry);
+    machine->physicalPageMap[frame].last_access = stats->totalTicks;
+    TouchFrame(frame);
+    return ticks;
+}
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::IsTextPage
+//      TRUE if virtual page "vpn" lies entirely within the code segment,
+//      so that it is never written and can be shared through the text
+//      page cache with other processes running the same executable.
+//----------------------------------------------------------------------
+
+bool
+ProcessAddrSpace::IsTextPage(unsigned vpn)
+{
+    return ((noffH.code.size > 0) && ((int)(vpn * PageSize) >= noffH.code.virtualAddr)
+                && ((int)((vpn + 1) * PageSize) <= noffH.code.virtualAddr + noffH.code.size));
+}
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::TextOffset
+//      Offset in the executable of code page "vpn", the key of the page
+//      in the text page cache.
+//----------------------------------------------------------------------
+
+int
+ProcessAddrSpace::TextOffset(unsigned vpn)
+{
+    return noffH.code.inFileAddr + vpn * PageSize - noffH.code.virtualAddr;
+}
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::ReadSegment
+//      Read the part of segment "seg" of the executable that falls in
+//      virtual page "vpn" into the same place in physical page "frame".
+//      Returns the number of bytes read.
+//----------------------------------------------------------------------
+
+int
+ProcessAddrSpace::ReadSegment(Segment *seg, unsigned vpn, int frame)
+{
+    int pageStart = vpn * PageSize;
+    int start = max(pageStart, seg->virtualAddr);
+    int end = min(pageStart + PageSize, seg->virtualAddr + seg->size);
+
+    if (start >= end) return 0;
+    return executable->ReadAt(&machine->mainMemory[frame * PageSize + start - pageStart],
+                        end - start, seg->inFileAddr + start - seg->virtualAddr);
+}
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::MapCachedPage
+//      Map "vpn" to "frame", which the text page cache or mmapCache says
+//      already holds it.  Code pages are mapped read-only.
+//----------------------------------------------------------------------
+
+void
+ProcessAddrSpace::MapCachedPage(unsigned vpn, int frame)
+{
+    ASSERT(machine->physicalPageMap[frame].refCount > 0);
+    TranslationEntry *entry = NachOSpageTable->Entry(vpn);
+
+    entry->physicalPage = frame;
+    entry->valid = TRUE;
+    entry->dirty = FALSE;
+    entry->readOnly = !entry->mapped;
+    machine->physicalPageMap[frame].refCount++;
+    machine->physicalPageMap[frame].refBit = 1;
+    machine->physicalPageMap[frame].last_access = stats->totalTicks;
+    TouchFrame(frame);
+}
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::ReleaseFrames
+//      Give up the resident pages of this process, except virtual page
+//      "keep", writing the dirty ones to swap.  With "unusedOnly", only
+//      the pages not referenced since the reference bits were last
+//      cleared are released, and the bits of the others are cleared.
+//      Pages shared with other processes are kept.  Returns the number
+//      of pages released; the page-out latency goes to pageOutTicks.
+//----------------------------------------------------------------------
+
+int
+ProcessAddrSpace::ReleaseFrames(int keep, bool unusedOnly)
+{
+    unsigned vpn;
+    int frame, released = 0, pid = currentThread->GetPID();
+    TranslationEntry *entry;
+
+    for (vpn = 0; (entry = NachOSpageTable->Next(&vpn)) != NULL; vpn++) {
+        if (!entry->valid || entry->shared || ((int)vpn == keep))
+            continue;
+        frame = entry->physicalPage;
+        if (machine->physicalPageMap[frame].refCount > 1)
+            continue;
+        if (unusedOnly && machine->physicalPageMap[frame].refBit) {
+            machine->physicalPageMap[frame].refBit = 0;
+            continue;
+        }
+        SwapOutAndInvalidate(frame, pid, entry);
+        ReleaseFrame(frame);
+        released++;
+    }
+    stats->numPagesReleased += released;
+    return released;
+}
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::Prepage
+//      Called on the first page fault since the process was switched
+//      back in.  Rather than take one fault per page, bring back in one
+//      batch the pages of the working set recorded when it was switched
+//      out that it has lost since, as long as there are free frames for
+//      them.  Swap slots are read in order, so that the arm sweeps
+//      across them once.  Returns the time the batch adds to the fault.
+//      Called with interrupts disabled.
+//----------------------------------------------------------------------
+
+int
+ProcessAddrSpace::Prepage()
+{
+    TranslationEntry *entry;
+    int i, j, n = 0, ticks = 0, t;
+    unsigned vpn;
+
+    for (i = 0; i < workingSetSize; i++) {	// move the lost pages first
+        vpn = workingSet[i];
+        entry = NachOSpageTable->Lookup(vpn);
+        if ((entry != NULL) && !entry->valid && ((vpn < shmBase) || entry->mapped)) {
+            workingSet[i] = workingSet[n];
+            workingSet[n++] = vpn;
+        }
+    }
+    for (i = 1; i < n; i++)			// sort them by swap slot
+        for (j = i; (j > 0) && (NachOSpageTable->Lookup(workingSet[j - 1])->swapSlot
+                                > NachOSpageTable->Lookup(workingSet[j])->swapSlot); j--) {
+            vpn = workingSet[j];
+            workingSet[j] = workingSet[j - 1];
+            workingSet[j - 1] = vpn;
+        }
+    for (i = 0; (i < n) && (machine->numFreeFrames > 0); i++) {
+        entry = NachOSpageTable->Lookup(workingSet[i]);
+        t = LoadPage(workingSet[i], TRUE);
+        if (t > 0)				// from the executable or a file
+            ticks += (entry->swapSlot != -1) ? t : ClusterPageTime;
+        entry->prepaged = TRUE;
+        stats->numPagesPrepaged++;
+    }
+    if (i > 0) {
+        DEBUG('k', "Prepaged %d pages of process %d\n", i, currentThread->GetPID());
+        stats->numPrepageBatches++;
+    }
+    return ticks;
+}
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::RefillTLB
+//      Called on a PageFaultException when there is a TLB.  If the page
+//      holding "vaddr" is resident, the fault was only a TLB miss: load
+//      its page table entry into the TLB and return TRUE.  Returns
+//      FALSE if the page has to be brought in by HandlePageFault.
+//      Called with interrupts disabled.
+//----------------------------------------------------------------------
+
+bool
+ProcessAddrSpace::RefillTLB(int vaddr)
+{
+    TranslationEntry *entry = NachOSpageTable->Lookup((unsigned)vaddr/PageSize);
+
+    if ((entry == NULL) || !entry->valid)
+        return FALSE;
+    tlbManager->Refill(entry, asid);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::HandleCopyOnWrite
+//      Called on a ReadOnlyException, i.e. the first write to a page
+//      shared copy-on-write since a fork.  If other page tables still
+//      map the frame, give the writer a private copy of it; otherwise
+//      the writer is the last user and simply gets write access back.
+//      Returns the disk time of any page-outs needed to free a frame,
+//      and sets "waitTicks" as HandlePageFault does, or returns -1 if
+//      the page is genuinely read-only: a code page shared through the
+//      text page cache.  Called with interrupts disabled.
+//----------------------------------------------------------------------
+
+int
+ProcessAddrSpace::HandleCopyOnWrite(int vaddr, int *waitTicks)
+{
+    unsigned vpn = (unsigned)vaddr/PageSize;
+    TranslationEntry *entry = NachOSpageTable->Entry(vpn);
+    int frame = entry->physicalPage, pid = currentThread->GetPID(), otherPid;
+    unsigned newFrame;
+    TranslationEntry *other;
+
+    ASSERT(vpn < numPagesInVM);
+    *waitTicks = 0;
+    if (!entry->cow) return -1;		// the program wrote to its code
+    ASSERT(entry->valid);
+    if (tlbManager != NULL) tlbManager->Invalidate(entry);
+    stats->numCowFaults++;
+    pageOutTicks = pageWaitTicks = 0;
+    (void) swapSpace->TakePoolTicks();	// left over from the daemons
+
+    if (machine->physicalPageMap[frame].refCount > 1) {
+        newFrame = getNewPage(frame);
+        DEBUG('k', "Copy-on-write: copying virtual page %d from physical page %d to %d\n",
+                                        vpn, frame, newFrame);
+        bcopy(&machine->mainMemory[frame * PageSize], &machine->mainMemory[newFrame * PageSize], PageSize);
+        stats->numCowCopies++;
+
+        machine->physicalPageMap[frame].refCount--;
+        if (machine->physicalPageMap[frame].entry == entry) {	// we were its recorded mapper
+            other = FindFrameMapper(frame, entry, &otherPid);
+            machine->physicalPageMap[frame].entry = other;
+            machine->physicalPageMap[frame].thread_id = (other != NULL) ? otherPid : -1;
+        }
+
+        entry->physicalPage = newFrame;
+        SetPhysicalMap(newFrame, pid, entry);
+        machine->fifoQueue->Append(newFrame);
+        machine->physicalPageMap[newFrame].last_access = stats->totalTicks;
+        TouchFrame(newFrame);
+        machine->physicalPageMap[newFrame].refBit = 1;
+    }
+    else SetPhysicalMap(frame, pid, entry);	// the others are gone
+
+    entry->cow = FALSE;
+    entry->readOnly = FALSE;
+    *waitTicks = pageWaitTicks + swapSpace->TakePoolTicks();
+    return pageOutTicks;
 }
@@ -16,8 +16,39 @@
 #include "copyright.h"
 #include "filesys.h"
 #include "noff.h"
+#include "shm.h"
 
 #define UserStackSize		1024 	// increase this as necessary!
+#define PageLoadTime		1000	// time to read a page from the executable
+
+// Tuning of the WSCLOCK and PFF algos; times are measured in
+// instructions executed by the process (its virtual time)
+#define WorkingSetWindow	1000	// a page used within this much is in the
+					// working set of its process
+#define PFFInterval		500	// a process faulting less often than this
+					// gives up the pages it has not used
+#define SuspendTime		5000	// ticks a process deactivated by load
+					// control stays out of memory
+
+#define ClusterPageTime		100	// time to read each page after the first
+					// in a clustered read from the executable
+
+#define MergeInterval		1000	// ticks between runs of the page merger
+#define MergePageTime		10	// ticks of its budget (-M) each frame
+					// it hashes costs
+
+#define ShmRegionPages		64	// pages above the stack reserved for
+					// shared memory segments and mapped files
+#define MAX_MMAPS		8	// files a process can have mapped at once
+
+class MappedFile {			// A file mapped by SYScall_Mmap
+  public:
+    char *name;				// Key of its pages in mmapCache;
+					// NULL if the slot is unused
+    OpenFile *file;			// Where its pages are read from
+    unsigned vpn;			// First virtual page of the mapping
+    int numPages;
+};
 
 class ProcessAddrSpace {
   public:
@@ -39,23 +70,69 @@ class ProcessAddrSpace {
     OpenFile* GetExecutable();
     NoffHeader GetNoffHeader();
 
-    TranslationEntry* GetPageTable();
+    PageTable* GetPageTable();
     int AddSharedMemory(unsigned size);
-    void HandlePageFault(int vaddr);
+    int AttachShared(int shmid, int vaddr);	// SYScall_ShmAttach
+    int DetachShared(int vaddr);		// SYScall_ShmDetach
+    int MapFile(char *name, int length);	// SYScall_Mmap
+    int UnmapFile(int vaddr);			// SYScall_Munmap
+    int HandlePageFault(int vaddr, int *waitTicks);	// Both return the disk
+    int HandleCopyOnWrite(int vaddr, int *waitTicks);	// time of the I/O, and
+					// the other time the faulting thread
+					// must sleep in waitTicks
+    bool RefillTLB(int vaddr);		// FALSE if the page is not resident
     char* GetFilename();
-    char* GetBackup();
+
+    void SetAtomicSequence(int start, int length);	// Used by SYScall_RasCtl
+    void RestartAtomicSequence(int *userRegisters);	// Called when the thread
+							// is switched out
+    bool IsSuspended();				// Deactivated by load control?
 
   private:
-    TranslationEntry *NachOSpageTable;	// Assume linear page table translation
-					// for now!
+    PageTable *NachOSpageTable;		// Two-level, leaves allocated as
+					// pages are first touched
+    int asid;				// Tags our TLB entries; never reused
     unsigned int numPagesInVM;		// Number of pages in the virtual 
 					// address space
+    unsigned shmBase;			// First page of the shared memory
+					// region, just above the stack
+    int shmAttachedAt[MAX_SHM_SEGMENTS];	// Page each segment is attached
+						// at, -1 if it is not
+    MappedFile mappings[MAX_MMAPS];	// Files mapped in the same region
     OpenFile *executable;               // The code I am excuting
     NoffHeader noffH;                   // The header of executable
-    char* filename;                     // We also store this as we need to pass it to the child
+    char* filename;                     // We also store this as we need to pass it to the child;
+					// our own copy, the key of our text pages
+
+    int rasStart, rasEnd;		// Restartable atomic sequence [start, end),
+					// empty if equal
+
+    unsigned lastFaultTime;		// Virtual time of the last page fault (PFF)
+    int suspendedUntil;			// Deactivated by load control until then
+
+    unsigned seqNextVpn;		// Page after the last one brought in; a
+					// fault there means sequential access
+    int readAhead;			// Current read-ahead window, in pages
+
+    unsigned *workingSet;		// Pages referenced before the last
+    int workingSetSize;			// switch out (-pp), NULL if off
+    bool prepagePending;		// No fault since switched back in?
+
+    int LoadPage(unsigned vpn, bool prefetch);	// Bring vpn into a free frame
+    int Prepage();				// Bring back the working set
 
-    char *backup;
+    int ReleaseFrames(int keep, bool unusedOnly);	// Give up resident pages
 
+    bool IsTextPage(unsigned vpn);		// Shared through the text page cache?
+    int TextOffset(unsigned vpn);		// Its key in the cache
+    int ReadSegment(Segment *seg, unsigned vpn, int frame);
+						// Load the part of seg in vpn
+    void MapCachedPage(unsigned vpn, int frame);	// Map a text or file page
+						// to the frame caching it
+    bool RegionIsFree(unsigned vpn, int count);	// Room for a segment?
+    void UnmapSegment(int shmid);		// Detach an attached segment
+    MappedFile *FindMapping(unsigned vpn);	// Mapping holding vpn
+    void UnmapMapping(MappedFile *map);		// Write back and unmap it
 };
 
 #endif // ADDRSPACE_H
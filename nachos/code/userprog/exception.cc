@@ -63,6 +63,24 @@ ForkStartFunction (int dummy)
    machine->Run();
 }
 
+// Terminate the current process with "exitcode", as SYScall_Exit does
+static void ExitCurrentProcess (int exitcode)
+{
+   unsigned i;
+
+   printf("[pid %d]: Exit called. Code: %d\n", currentThread->GetPID(), exitcode);
+   // We do not wait for the children to finish.
+   // The children will continue to run.
+   // We will worry about this when and if we implement signals.
+   exitThreadArray[currentThread->GetPID()] = true;
+
+   // Find out if all threads have called exit
+   for (i=0; i<thread_index; i++) {
+      if (!exitThreadArray[i]) break;
+   }
+   currentThread->Exit(i==thread_index, exitcode);
+}
+
 static void ConvertIntToHex (unsigned v, Console *console)
 {
    unsigned x;
@@ -98,6 +116,7 @@ ExceptionHandler(ExceptionType which)
     int whichChild;		// Used in SYScall_Join
     NachOSThread *child;		// Used by SYScall_Fork
     unsigned sleeptime;		// Used by SYScall_Sleep
+    int id;			// Used by the semaphore calls
 
     if ((which == SyscallException) && (type == SYScall_Halt)) {
 	DEBUG('a', "Shutdown, initiated by user program.\n");
@@ -105,17 +124,7 @@ ExceptionHandler(ExceptionType which)
     }
     else if ((which == SyscallException) && (type == SYScall_Exit)) {
        exitcode = machine->ReadRegister(4);
-       printf("[pid %d]: Exit called. Code: %d\n", currentThread->GetPID(), exitcode);
-       // We do not wait for the children to finish.
-       // The children will continue to run.
-       // We will worry about this when and if we implement signals.
-       exitThreadArray[currentThread->GetPID()] = true;
-
-       // Find out if all threads have called exit
-       for (i=0; i<thread_index; i++) {
-          if (!exitThreadArray[i]) break;
-       }
-       currentThread->Exit(i==thread_index, exitcode);
+       ExitCurrentProcess(exitcode);
     }
     else if ((which == SyscallException) && (type == SYScall_Exec)) {
        // Copy the executable name into kernel space
@@ -301,6 +310,73 @@ ExceptionHandler(ExceptionType which)
        machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
        machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
     }
+    else if ((which == SyscallException) && (type == SYScall_SemGet)) {
+       tempval = machine->ReadRegister(4);	// key
+       id = -1;
+       for (i=0; i<MAX_SEMAPHORE_COUNT; i++) {
+          if ((semaphoreArray[i] != NULL) && (semaphoreKey[i] == tempval)) break;
+          if ((semaphoreArray[i] == NULL) && (id == -1)) id = i;
+       }
+       if (i < MAX_SEMAPHORE_COUNT) id = i;		// existing semaphore
+       else if (id != -1) {				// create it
+          semaphoreArray[id] = new Semaphore("user semaphore", 0);
+          semaphoreKey[id] = tempval;
+       }
+       machine->WriteRegister(2, id);
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    }
+    else if ((which == SyscallException) && (type == SYScall_SemOp)) {
+       id = machine->ReadRegister(4);
+       if ((id < 0) || (id >= MAX_SEMAPHORE_COUNT) || (semaphoreArray[id] == NULL)) {
+          machine->WriteRegister(2, -1);
+       }
+       else {
+          if (machine->ReadRegister(5) < 0) semaphoreArray[id]->P();
+          else semaphoreArray[id]->V();
+          machine->WriteRegister(2, 0);
+       }
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    }
+    else if ((which == SyscallException) && (type == SYScall_SemCtl)) {
+       id = machine->ReadRegister(4);
+       vaddr = machine->ReadRegister(6);
+       if ((id < 0) || (id >= MAX_SEMAPHORE_COUNT) || (semaphoreArray[id] == NULL)) {
+          machine->WriteRegister(2, -1);
+       }
+       else if (machine->ReadRegister(5) == SYNCH_REMOVE) {
+          if (semaphoreArray[id]->HasWaiters()) {	// they point at it
+             machine->WriteRegister(2, -1);
+          }
+          else {
+             delete semaphoreArray[id];
+             semaphoreArray[id] = NULL;
+             machine->WriteRegister(2, 0);
+          }
+       }
+       else if (machine->ReadRegister(5) == SYNCH_GET) {
+          while (!machine->WriteMem(vaddr, 4, semaphoreArray[id]->GetValue()));
+          machine->WriteRegister(2, 0);
+       }
+       else if (machine->ReadRegister(5) == SYNCH_SET) {
+          while (!machine->ReadMem(vaddr, 4, &memval));
+          if (memval < 0) machine->WriteRegister(2, -1);
+          else {
+             semaphoreArray[id]->SetValue(memval);
+             machine->WriteRegister(2, 0);
+          }
+       }
+       else machine->WriteRegister(2, -1);
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    }
     else if ((which == SyscallException) && (type == SYScall_ShmAllocate)) {
        i = (unsigned)machine->ReadRegister(4);
        machine->WriteRegister(2, currentThread->space->AddSharedMemory(i));
@@ -309,12 +385,177 @@ ExceptionHandler(ExceptionType which)
        machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
        machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
     }
+    else if ((which == SyscallException) && (type == SYScall_FutexWait)) {
+       vaddr = machine->ReadRegister(4);
+       machine->WriteRegister(2, futexTable->Wait(vaddr, machine->ReadRegister(5)));
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    }
+    else if ((which == SyscallException) && (type == SYScall_FutexWake)) {
+       vaddr = machine->ReadRegister(4);
+       machine->WriteRegister(2, futexTable->Wake(vaddr, machine->ReadRegister(5)));
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    }
+    else if ((which == SyscallException) && (type == SYScall_RasCtl)) {
+       currentThread->space->SetAtomicSequence(machine->ReadRegister(4), machine->ReadRegister(5));
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    }
+    else if ((which == SyscallException) && (type == SYScall_BarrierGet)) {
+       tempval = machine->ReadRegister(4);	// key
+       id = -1;
+       for (i=0; i<MAX_BARRIER_COUNT; i++) {
+          if ((barrierArray[i] != NULL) && (barrierKey[i] == tempval)) break;
+          if ((barrierArray[i] == NULL) && (id == -1)) id = i;
+       }
+       if (i < MAX_BARRIER_COUNT) id = i;		// existing barrier
+       else if (machine->ReadRegister(5) <= 0) id = -1;	// no participants
+       else if (id != -1) {				// create it
+          barrierArray[id] = new Barrier("user barrier", machine->ReadRegister(5));
+          barrierKey[id] = tempval;
+       }
+       machine->WriteRegister(2, id);
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    }
+    else if ((which == SyscallException) && (type == SYScall_BarrierWait)) {
+       id = machine->ReadRegister(4);
+       if ((id < 0) || (id >= MAX_BARRIER_COUNT) || (barrierArray[id] == NULL)) {
+          machine->WriteRegister(2, -1);
+       }
+       else {
+          barrierArray[id]->Wait();
+          machine->WriteRegister(2, 0);
+       }
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    }
+    else if ((which == SyscallException) && (type == SYScall_RWLockGet)) {
+       tempval = machine->ReadRegister(4);	// key
+       id = -1;
+       for (i=0; i<MAX_RWLOCK_COUNT; i++) {
+          if ((rwlockArray[i] != NULL) && (rwlockKey[i] == tempval)) break;
+          if ((rwlockArray[i] == NULL) && (id == -1)) id = i;
+       }
+       if (i < MAX_RWLOCK_COUNT) id = i;		// existing lock
+       else if (id != -1) {				// create it
+          rwlockArray[id] = new RWLock("user rwlock", machine->ReadRegister(5) != 0);
+          rwlockKey[id] = tempval;
+       }
+       machine->WriteRegister(2, id);
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    }
+    else if ((which == SyscallException) && (type == SYScall_RWLockOp)) {
+       id = machine->ReadRegister(4);
+       tempval = -1;
+       if ((id >= 0) && (id < MAX_RWLOCK_COUNT) && (rwlockArray[id] != NULL)) {
+          switch (machine->ReadRegister(5)) {
+             case RWLOCK_OP_READ_ACQUIRE: rwlockArray[id]->AcquireRead(); tempval = 0; break;
+             case RWLOCK_OP_READ_RELEASE: if (rwlockArray[id]->ReleaseRead()) tempval = 0; break;
+             case RWLOCK_OP_WRITE_ACQUIRE: rwlockArray[id]->AcquireWrite(); tempval = 0; break;
+             case RWLOCK_OP_WRITE_RELEASE: if (rwlockArray[id]->ReleaseWrite()) tempval = 0; break;
+             default: break;			// unknown op
+          }
+       }
+       machine->WriteRegister(2, tempval);
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    }
+    else if ((which == SyscallException) && (type == SYScall_ShmGet)) {
+       machine->WriteRegister(2, shmTable->Get(machine->ReadRegister(4), (unsigned)machine->ReadRegister(5)));
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    }
+    else if ((which == SyscallException) && (type == SYScall_ShmAttach)) {
+       machine->WriteRegister(2, currentThread->space->AttachShared(machine->ReadRegister(4), machine->ReadRegister(5)));
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    }
+    else if ((which == SyscallException) && (type == SYScall_ShmDetach)) {
+       machine->WriteRegister(2, currentThread->space->DetachShared(machine->ReadRegister(4)));
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    }
+    else if ((which == SyscallException) && (type == SYScall_Mmap)) {
+       // Copy the file name into kernel space
+       vaddr = machine->ReadRegister(4);
+       while (!machine->ReadMem(vaddr, 1, &memval));
+       i = 0;
+       while ((*(char*)&memval) != '\0') {
+          buffer[i] = (*(char*)&memval);
+          i++;
+          vaddr++;
+          while (!machine->ReadMem(vaddr, 1, &memval));
+       }
+       buffer[i] = (*(char*)&memval);
+       machine->WriteRegister(2, currentThread->space->MapFile(buffer, machine->ReadRegister(5)));
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    }
+    else if ((which == SyscallException) && (type == SYScall_Munmap)) {
+       machine->WriteRegister(2, currentThread->space->UnmapFile(machine->ReadRegister(4)));
+       // Advance program counters.
+       machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+       machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+       machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+    }
+    else if (which == ReadOnlyException) {
+        // Write to a copy-on-write page; the instruction is retried
+        // once the page is writable.  A write to a code page kills
+        // the process.
+        IntStatus oldLevel = interrupt->SetLevel(IntOff);
+        int waitTicks;
+        int ticks = currentThread->space->HandleCopyOnWrite(machine->registers[BadVAddrReg], &waitTicks);
+        (void) interrupt->SetLevel(oldLevel);
+        if (ticks < 0) {
+            printf("[pid %d]: Write to read-only address 0x%x\n", currentThread->GetPID(),
+                                machine->registers[BadVAddrReg]);
+            ExitCurrentProcess(-1);
+        }
+        if (ticks > 0)		// had to swap out to find a frame
+            ticks = swapSpace->Enqueue(ticks);
+        if (ticks + waitTicks > 0)
+            currentThread->WaitForPageIO(ticks, waitTicks);
+    }
     else if ((which == PageFaultException)) {
         IntStatus oldLevel = interrupt->SetLevel(IntOff);  // disable interrupts
         unsigned badVAdr = machine->registers[BadVAddrReg];
-        currentThread->space->HandlePageFault(badVAdr);
+        int ticks = 0, waitTicks = 0;
+        if ((tlbManager == NULL) || !currentThread->space->RefillTLB(badVAdr))
+            ticks = currentThread->space->HandlePageFault(badVAdr, &waitTicks);
         (void) interrupt->SetLevel(oldLevel);  // re-enable interrupts
-        currentThread->SortedInsertInWaitQueue (1000+stats->totalTicks);
+        if (ticks < 0) {	// unused part of the shared memory region
+            printf("[pid %d]: Address error at 0x%x\n", currentThread->GetPID(), badVAdr);
+            ExitCurrentProcess(-1);
+        }
+        if (ticks > 0)		// not a TLB miss, nor just mapped from a cache
+            ticks = swapSpace->Enqueue(ticks);	// only disk time holds the disk
+        if (ticks + waitTicks > 0)
+            currentThread->WaitForPageIO(ticks, waitTicks);
     } else {
 	printf("Unexpected user mode exception %d %d\n", which, type);
 	ASSERT(FALSE);
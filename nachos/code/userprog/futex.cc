@@ -0,0 +1,125 @@
+// futex.cc
+//	Routines implementing the kernel half of futexes: a hash table
+//	of wait queues keyed by the physical address of a user word.
+//
+//	The check of the user word and the decision to sleep must be
+//	atomic with respect to FutexWake, otherwise a wakeup sent between
+//	the two would be lost.  As everywhere else in Nachos, atomicity
+//	comes from disabling interrupts.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "futex.h"
+#include "system.h"
+
+#define FutexHash(paddr)	(((unsigned)(paddr) >> 2) % FUTEX_HASH_SIZE)
+
+//----------------------------------------------------------------------
+// FutexTable::FutexTable
+// 	Initialize every wait queue to empty.
+//----------------------------------------------------------------------
+
+FutexTable::FutexTable()
+{
+    for (int i = 0; i < FUTEX_HASH_SIZE; i++)
+       head[i] = tail[i] = NULL;
+}
+
+//----------------------------------------------------------------------
+// FutexTable::~FutexTable
+// 	Waiters live on the stacks of the sleeping threads, so there is
+//	nothing to de-allocate.
+//----------------------------------------------------------------------
+
+FutexTable::~FutexTable()
+{}
+
+//----------------------------------------------------------------------
+// FutexTable::LockWord
+// 	Make sure the page holding the futex word is resident, then
+//	disable interrupts and return the physical address of the word.
+//	Interrupts are left disabled; the caller restores them.
+//
+//	The page has to be brought in with interrupts enabled, because a
+//	page fault puts the faulting thread to sleep.
+//----------------------------------------------------------------------
+
+int
+FutexTable::LockWord(int vaddr)
+{
+    int memval, paddr;
+
+    for (;;) {
+       while (!machine->ReadMem(vaddr, 4, &memval));
+       (void) interrupt->SetLevel(IntOff);
+       paddr = machine->GetPA(vaddr);
+       if (paddr != -1) return paddr;
+       (void) interrupt->SetLevel(IntOn);	// lost the page, try again
+    }
+}
+
+//----------------------------------------------------------------------
+// FutexTable::Wait
+// 	Called by SYScall_FutexWait.  If the word at "vaddr" still holds
+//	"value", put the caller to sleep on the queue for that word.
+//	Returns 0 once woken up, -1 if the word did not hold "value".
+//----------------------------------------------------------------------
+
+int
+FutexTable::Wait(int vaddr, int value)
+{
+    IntStatus oldLevel = interrupt->getLevel();
+    int paddr = LockWord(vaddr);
+    int bucket = FutexHash(paddr);
+
+    if ((int)WordToHost(*(unsigned *)&machine->mainMemory[paddr]) != value) {
+       (void) interrupt->SetLevel(oldLevel);
+       return -1;
+    }
+
+    FutexWaiter waiter(currentThread, paddr);
+    if (head[bucket] == NULL) head[bucket] = &waiter;
+    else tail[bucket]->SetNext(&waiter);
+    tail[bucket] = &waiter;
+
+    DEBUG('s', "[pid %d] futex wait on PA 0x%x\n", currentThread->GetPID(), paddr);
+    currentThread->PutThreadToSleep();		// FutexWake unlinks the waiter
+    (void) interrupt->SetLevel(oldLevel);
+    return 0;
+}
+
+//----------------------------------------------------------------------
+// FutexTable::Wake
+// 	Called by SYScall_FutexWake.  Wake up to "count" threads sleeping
+//	on the word at "vaddr", in the order in which they went to sleep.
+//	Returns the number of threads woken up.
+//----------------------------------------------------------------------
+
+int
+FutexTable::Wake(int vaddr, int count)
+{
+    IntStatus oldLevel = interrupt->getLevel();
+    int paddr = LockWord(vaddr);
+    int bucket = FutexHash(paddr);
+    int woken = 0;
+    FutexWaiter *ptr = head[bucket], *prev = NULL, *next;
+
+    while ((ptr != NULL) && (woken < count)) {
+       next = ptr->GetNext();
+       if (ptr->GetKey() == paddr) {
+          if (prev == NULL) head[bucket] = next;
+          else prev->SetNext(next);
+          if (tail[bucket] == ptr) tail[bucket] = prev;
+          scheduler->ThreadIsReadyToRun(ptr->GetThread());
+          woken++;
+       }
+       else prev = ptr;
+       ptr = next;
+    }
+    DEBUG('s', "[pid %d] futex wake on PA 0x%x woke %d\n", currentThread->GetPID(), paddr, woken);
+    (void) interrupt->SetLevel(oldLevel);
+    return woken;
+}
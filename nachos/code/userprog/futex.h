@@ -0,0 +1,69 @@
+// futex.h
+//	Data structures for fast user-level synchronization (futexes).
+//
+//	A futex is simply a word of user memory, normally in a page
+//	obtained with system_call_ShmAllocate.  User level locks built
+//	on top of it (see test/ulock.c) manipulate the word with an
+//	atomic compare-and-swap and never enter the kernel as long as
+//	there is no contention.  Only a thread that finds the word in
+//	a contended state calls FutexWait to go to sleep, and only the
+//	thread that releases a contended lock calls FutexWake.
+//
+//	Sleeping threads are kept in a hash table of wait queues keyed
+//	by the physical address of the futex word, so that processes
+//	sharing the page agree on the key regardless of where the page
+//	sits in their virtual address spaces.  Physical addresses are
+//	stable only for pages that are never replaced, which is the
+//	case for shared pages.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#include "copyright.h"
+#include "thread.h"
+
+#define FUTEX_HASH_SIZE		64	// Number of wait queues
+
+// One sleeping thread.  The waiter lives on the kernel stack of the
+// sleeping thread, so blocking on a futex does not allocate memory.
+
+class FutexWaiter {
+private:
+   NachOSThread *t;			// The sleeping thread
+   int key;				// Physical address it is waiting on
+   FutexWaiter *next;			// Build the list
+
+public:
+   FutexWaiter (NachOSThread *th, int k) { t = th; key = k; next = NULL; }
+   ~FutexWaiter (void) {}
+
+   NachOSThread *GetThread (void) { return t; }
+   int GetKey (void) { return key; }
+   FutexWaiter *GetNext (void) { return next; }
+   void SetNext (FutexWaiter *n) { next = n; }
+};
+
+class FutexTable {
+  public:
+    FutexTable();			// Initialize all queues to empty
+    ~FutexTable();
+
+    int Wait(int vaddr, int value);	// Sleep if the word at vaddr still
+					// holds value; returns 0 once woken,
+					// -1 if the value had changed
+    int Wake(int vaddr, int count);	// Wake up to count sleepers on the
+					// word at vaddr; returns # woken
+
+  private:
+    FutexWaiter *head[FUTEX_HASH_SIZE];	// FIFO wait queue per bucket
+    FutexWaiter *tail[FUTEX_HASH_SIZE];
+
+    int LockWord(int vaddr);		// Fault in the word, disable
+					// interrupts, return its PA
+};
+
+#endif // FUTEX_H
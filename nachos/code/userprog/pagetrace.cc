@@ -0,0 +1,77 @@
+// pagetrace.cc
+//	Routines to record the page reference stream in a trace file.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "pagetrace.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// PageTrace::PageTrace
+// 	Create the UNIX file "name" and write the trace header to it.
+//----------------------------------------------------------------------
+
+PageTrace::PageTrace(char *name)
+{
+    TraceHeader header;
+
+    fileno = OpenForWrite(name);
+    header.traceMagic = TRACEMAGIC;
+    header.pageSize = PageSize;
+    header.numPhysPages = NumPhysPages;
+    WriteFile(fileno, (char *)&header, sizeof(header));
+    numBuffered = 0;
+    lastPid = lastVpn = -1;
+    lastWriting = FALSE;
+}
+
+//----------------------------------------------------------------------
+// PageTrace::~PageTrace
+//----------------------------------------------------------------------
+
+PageTrace::~PageTrace()
+{
+    Flush();
+    Close(fileno);
+}
+
+//----------------------------------------------------------------------
+// PageTrace::Record
+// 	Called by Machine::Translate for every reference that found its
+//	page in memory.  A repeated reference to the page touched last
+//	is dropped, unless it is the first write after reads.
+//----------------------------------------------------------------------
+
+void
+PageTrace::Record(int pid, int vpn, bool writing)
+{
+    TraceRecord *rec;
+
+    if ((pid == lastPid) && (vpn == lastVpn) && (lastWriting || !writing))
+        return;
+    ASSERT(vpn < TRACE_WRITE);
+    if (numBuffered == TraceBufferSize)
+        Flush();
+    rec = &buffer[numBuffered++];
+    rec->tick = stats->totalTicks;
+    rec->pid = pid;
+    rec->page = vpn | (writing ? TRACE_WRITE : 0);
+    lastWriting = writing;
+    lastPid = pid;
+    lastVpn = vpn;
+}
+
+//----------------------------------------------------------------------
+// PageTrace::Flush
+//----------------------------------------------------------------------
+
+void
+PageTrace::Flush()
+{
+    if (numBuffered > 0)
+        WriteFile(fileno, (char *)buffer, numBuffered * sizeof(TraceRecord));
+    numBuffered = 0;
+}
@@ -0,0 +1,42 @@
+// pagetrace.h
+//	Data structures for recording the page reference stream of the
+//	user programs, so that replacement policies can be compared
+//	offline (see bin/replay.c) instead of by re-running Nachos once
+//	for every policy and memory size.
+//
+//	Machine::Translate reports every successful translation; the
+//	records go to a UNIX file in the format of bin/trace.h, through
+//	a buffer so that tracing costs one write per TraceBufferSize
+//	references.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PAGETRACE_H
+#define PAGETRACE_H
+
+#include "copyright.h"
+#include "trace.h"
+
+#define TraceBufferSize	1024	// Records buffered before each write
+
+class PageTrace {
+  public:
+    PageTrace(char *name);		// Create the trace file "name"
+    ~PageTrace();			// Flush and close it
+
+    void Record(int pid, int vpn, bool writing);
+					// A reference to vpn by pid
+
+  private:
+    int fileno;				// UNIX file number of the trace
+    TraceRecord buffer[TraceBufferSize];
+    int numBuffered;			// Records not yet written
+    int lastPid, lastVpn;		// Previous reference, which the
+    bool lastWriting;			// next one may repeat
+
+    void Flush();			// Write out the buffer
+};
+
+#endif // PAGETRACE_H
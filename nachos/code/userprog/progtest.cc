@@ -38,6 +38,13 @@ StartUserProcess(char *filename)
 	printf("Unable to open file %s\n", filename);
 	return;
     }
+    if (currentThread->space != NULL) {	// Exec replaces the old image
+        IntStatus oldLevel = interrupt->SetLevel(IntOff);
+        space = currentThread->space;
+        currentThread->space = NULL;
+        delete space;			// free its frames first
+        (void) interrupt->SetLevel(oldLevel);
+    }
     space = new ProcessAddrSpace(executable, filename);
     currentThread->space = space;
 
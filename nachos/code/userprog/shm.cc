@@ -0,0 +1,99 @@
+// shm.cc
+//	Routines to create, look up and remove named shared memory
+//	segments.  Mapping them into address spaces is done by
+//	ProcessAddrSpace::AttachShared and DetachShared.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "shm.h"
+#include "system.h"
+#include "syscall.h"
+
+//----------------------------------------------------------------------
+// SharedSegment::SharedSegment
+// 	A segment of "numPages" pages, not attached anywhere yet.
+//----------------------------------------------------------------------
+
+SharedSegment::SharedSegment(int k, int n)
+{
+    key = k;
+    numPages = n;
+    frames = new int[n];
+    for (int i = 0; i < n; i++)
+        frames[i] = -1;
+    numAttached = 0;
+}
+
+SharedSegment::~SharedSegment()
+{
+    delete [] frames;
+}
+
+//----------------------------------------------------------------------
+// ShmTable::ShmTable
+//----------------------------------------------------------------------
+
+ShmTable::ShmTable()
+{
+    for (int i = 0; i < MAX_SHM_SEGMENTS; i++)
+        segments[i] = NULL;
+}
+
+ShmTable::~ShmTable()
+{
+    for (int i = 0; i < MAX_SHM_SEGMENTS; i++)
+        if (segments[i] != NULL) delete segments[i];
+}
+
+//----------------------------------------------------------------------
+// ShmTable::Get
+// 	Called by SYScall_ShmGet.  Return the id of the segment named
+//	"key", creating it with room for "size" bytes if there is none.
+//	SHM_PRIVATE always creates a new segment.  Returns -1 if the
+//	table is full, or if the segment is too small or too big.
+//----------------------------------------------------------------------
+
+int
+ShmTable::Get(int key, unsigned size)
+{
+    int i, id = -1, numPages = divRoundUp(size, PageSize);
+
+    for (i = 0; i < MAX_SHM_SEGMENTS; i++) {
+        if ((segments[i] != NULL) && (key != SHM_PRIVATE) && (segments[i]->key == key))
+            return (numPages <= segments[i]->numPages) ? i : -1;
+        if ((segments[i] == NULL) && (id == -1)) id = i;
+    }
+    if ((id == -1) || (numPages == 0) || (numPages > ShmRegionPages))
+        return -1;
+    segments[id] = new SharedSegment(key, numPages);
+    DEBUG('k', "Created shared segment %d, key %d, %d pages\n", id, key, numPages);
+    return id;
+}
+
+//----------------------------------------------------------------------
+// ShmTable::GetSegment
+//----------------------------------------------------------------------
+
+SharedSegment *
+ShmTable::GetSegment(int shmid)
+{
+    if ((shmid < 0) || (shmid >= MAX_SHM_SEGMENTS)) return NULL;
+    return segments[shmid];
+}
+
+//----------------------------------------------------------------------
+// ShmTable::Remove
+// 	Forget segment "shmid", whose frames have already been released.
+//----------------------------------------------------------------------
+
+void
+ShmTable::Remove(int shmid)
+{
+    ASSERT(segments[shmid]->numAttached == 0);
+    DEBUG('k', "Removed shared segment %d\n", shmid);
+    delete segments[shmid];
+    segments[shmid] = NULL;
+}
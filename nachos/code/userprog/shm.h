@@ -0,0 +1,57 @@
+// shm.h
+//	Data structures for named shared memory segments.
+//
+//	A segment is a run of pages that any process can attach to its
+//	address space, by key, with SYScall_ShmGet and SYScall_ShmAttach;
+//	it does not have to be inherited through a fork.  Every address
+//	space reserves ShmRegionPages pages above its stack for attached
+//	segments, so attaching one only fills in page table entries that
+//	are already there.
+//
+//	The frames of a segment are allocated when it is first attached
+//	and never replaced.  The segment counts the address spaces it is
+//	attached to (forks included); it and its frames go away when the
+//	last one detaches, by SYScall_ShmDetach or by exiting.  A segment
+//	created by SYScall_ShmGet but never attached stays in the table,
+//	so that other processes can still find it by key, until it has
+//	been attached and detached again.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SHM_H
+#define SHM_H
+
+#include "copyright.h"
+
+#define MAX_SHM_SEGMENTS	16	// Segments available through SYScall_ShmGet
+
+class SharedSegment {
+  public:
+    SharedSegment(int key, int numPages);
+    ~SharedSegment();
+
+    int key;				// Name given to SYScall_ShmGet
+    int numPages;			// Size of the segment
+    int *frames;			// Physical page of each page, -1
+					// until first attached
+    int numAttached;			// Address spaces it is attached to
+};
+
+class ShmTable {
+  public:
+    ShmTable();				// Initialize an empty table
+    ~ShmTable();
+
+    int Get(int key, unsigned size);	// Id of the segment named key,
+					// created with size bytes if new;
+					// -1 if that is not possible
+    SharedSegment *GetSegment(int shmid);	// NULL if there is none
+    void Remove(int shmid);		// Called on the last detach
+
+  private:
+    SharedSegment *segments[MAX_SHM_SEGMENTS];
+};
+
+#endif // SHM_H
@@ -0,0 +1,224 @@
+// swap.cc
+//	Routines to manage the swap area: allocate and share slots, and
+//	move pages between main memory and the swap file.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "swap.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// SwapSpace::SwapSpace
+// 	Create an empty swap area in the UNIX file "name".  The file
+//	grows as slots are written, so it stays sparse.  "poolBytes" is
+//	the budget of the compressed pool, 0 for no pool.
+//----------------------------------------------------------------------
+
+SwapSpace::SwapSpace(char *name, int poolBytes)
+{
+    fileName = name;
+    fileno = OpenForWrite(name);
+    Close(fileno);
+    fileno = OpenForReadWrite(name, TRUE);
+    freeMap = new BitMap(NumSwapSlots);
+    for (int i = 0; i < NumSwapSlots; i++)
+        refCount[i] = 0;
+    lastSlot = 0;
+    busyUntil = 0;
+    poolTicks = 0;
+    pool = (poolBytes > 0) ? new CompressedPool(NumSwapSlots, poolBytes) : NULL;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::~SwapSpace
+// 	Nothing in the swap area outlives Nachos.
+//----------------------------------------------------------------------
+
+SwapSpace::~SwapSpace()
+{
+    Close(fileno);
+    Unlink(fileName);
+    delete freeMap;
+    if (pool != NULL) delete pool;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::Allocate
+// 	Return a free slot with a reference count of one, or -1 if the
+//	swap area is full.
+//----------------------------------------------------------------------
+
+int
+SwapSpace::Allocate()
+{
+    int slot = freeMap->Find();
+
+    if (slot != -1) refCount[slot] = 1;
+    return slot;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::Share
+// 	Called when a fork copies a page table entry that refers to
+//	"slot".  The slot is not overwritten while it is shared.
+//----------------------------------------------------------------------
+
+void
+SwapSpace::Share(int slot)
+{
+    ASSERT(freeMap->Test(slot));
+    refCount[slot]++;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::Free
+// 	Drop one reference to "slot", releasing it with the last one.
+//----------------------------------------------------------------------
+
+void
+SwapSpace::Free(int slot)
+{
+    ASSERT(freeMap->Test(slot) && (refCount[slot] > 0));
+    if (--refCount[slot] == 0) {
+        freeMap->Clear(slot);
+        if (pool != NULL) pool->Drop(slot);
+    }
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::ComputeLatency
+// 	Return how long a transfer to or from "slot" would take on the
+//	disk of disk.h, one page per sector: seek to the track, wait for
+//	the sector to come around, then transfer it.
+//----------------------------------------------------------------------
+
+int
+SwapSpace::ComputeLatency(int slot)
+{
+    int seek = abs(slot / SectorsPerTrack - lastSlot / SectorsPerTrack) * SeekTime;
+    int under = ((stats->totalTicks + seek) / RotationTime) % SectorsPerTrack;
+    int rotation = ((slot % SectorsPerTrack - under) + SectorsPerTrack) % SectorsPerTrack;
+
+    lastSlot = slot;
+    return seek + rotation * RotationTime + RotationTime;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::Enqueue
+// 	Queue "ticks" of transfers on the paging disk, behind those
+//	already queued, and return how long until they are done.
+//----------------------------------------------------------------------
+
+int
+SwapSpace::Enqueue(int ticks)
+{
+    busyUntil = max(busyUntil, stats->totalTicks) + ticks;
+    return busyUntil - stats->totalTicks;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::TakePoolTicks
+// 	Return the time spent compressing and decompressing pages since
+//	the last call.  The caller sleeps for it, but it does not hold
+//	up the paging disk.
+//----------------------------------------------------------------------
+
+int
+SwapSpace::TakePoolTicks()
+{
+    int ticks = poolTicks;
+
+    poolTicks = 0;
+    return ticks;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::WriteSlot
+// 	Write the page at "from" to "slot" in the swap file, and return
+//	the latency.
+//----------------------------------------------------------------------
+
+int
+SwapSpace::WriteSlot(int slot, char *from)
+{
+    int ticks = ComputeLatency(slot);
+
+    DEBUG('k', "Swapping out to slot %d, %d ticks\n", slot, ticks);
+    Lseek(fileno, slot * PageSize, 0);
+    WriteFile(fileno, from, PageSize);
+    stats->numSwapOuts++;
+    stats->swapOutTicks += ticks;
+    return ticks;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::Spill
+// 	Move the page of "slot" from the compressed pool to the swap
+//	file, and return the disk latency.
+//----------------------------------------------------------------------
+
+int
+SwapSpace::Spill(int slot)
+{
+    char page[PageSize];
+    bool found = pool->Load(slot, page);
+
+    ASSERT(found);
+    pool->Drop(slot);
+    stats->numZpoolSpills++;
+    poolTicks += ZpoolPageTime;
+    return WriteSlot(slot, page);
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::PageOut
+// 	Write the page at "from" to "slot", and return the disk latency.
+//	The page goes to the compressed pool if there is one and the page
+//	compresses well; the pool then spills what no longer fits.
+//----------------------------------------------------------------------
+
+int
+SwapSpace::PageOut(int slot, char *from)
+{
+    int ticks = 0;
+
+    ASSERT(freeMap->Test(slot));
+    if ((pool != NULL) && pool->Store(slot, from)) {
+        poolTicks += ZpoolPageTime;
+        while (pool->OverBudget())
+            ticks += Spill(pool->Oldest());
+        return ticks;
+    }
+    if (pool != NULL) pool->Drop(slot);		// an older copy
+    return WriteSlot(slot, from);
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::PageIn
+// 	Read the page in "slot" into "into", and return the disk latency,
+//	0 if it came from the compressed pool.
+//----------------------------------------------------------------------
+
+int
+SwapSpace::PageIn(int slot, char *into)
+{
+    int ticks;
+
+    ASSERT(freeMap->Test(slot));
+    if ((pool != NULL) && pool->Load(slot, into)) {
+        DEBUG('k', "Swapping in from slot %d in the compressed pool\n", slot);
+        stats->numZpoolHits++;
+        poolTicks += ZpoolPageTime;
+        return 0;
+    }
+    ticks = ComputeLatency(slot);
+    DEBUG('k', "Swapping in from slot %d, %d ticks\n", slot, ticks);
+    Lseek(fileno, slot * PageSize, 0);
+    Read(fileno, into, PageSize);
+    stats->numSwapIns++;
+    stats->swapInTicks += ticks;
+    return ticks;
+}
@@ -0,0 +1,77 @@
+// swap.h
+//	Data structures for the swap area, the backing store for dirty
+//	pages evicted from main memory.
+//
+//	The swap area is an array of page-sized slots kept in a UNIX file
+//	(named "SWAP"), so that backing store costs host memory only for
+//	the pages actually swapped out, rather than for the whole virtual
+//	address space of every process.  Slots are handed out sparsely
+//	from a bitmap; a slot may be shared by the parent and child of a
+//	fork, so each one carries a reference count.
+//
+//	Transfers happen immediately on the host, but each one returns
+//	the time it would have taken on a disk like the one in disk.h:
+//	seek to the track holding the slot, rotate to it, transfer it.
+//	The paging disk does one transfer at a time: Enqueue starts the
+//	transfers of a page fault once those already queued are done,
+//	and the faulting thread sleeps until a disk interrupt signals
+//	their completion (NachOSThread::WaitForPageIO).  Other threads
+//	run meanwhile.
+//
+//	With a compressed pool (see zpool.h), pages that compress well
+//	stay in host memory instead, and cost only the time to compress
+//	and decompress them until the pool spills them to the file.  That
+//	time is CPU time, not disk time: PageOut and PageIn leave it out
+//	of the latency they return, and TakePoolTicks collects it.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SWAP_H
+#define SWAP_H
+
+#include "copyright.h"
+#include "bitmap.h"
+#include "zpool.h"
+
+#define NumSwapSlots	4096	// Pages of backing store
+
+class SwapSpace {
+  public:
+    SwapSpace(char *name, int poolBytes);	// Create the swap file "name",
+					// with a compressed pool of that
+					// many bytes in front of it (0: none)
+    ~SwapSpace();			// Close and remove it
+
+    int Allocate();			// Return a free slot, -1 if none
+    void Share(int slot);		// One more page table refers to slot
+    void Free(int slot);		// One less; release it at zero
+    bool IsShared(int slot) { return (refCount[slot] > 1); }
+
+    int PageOut(int slot, char *from);	// Write a page to slot, return
+					// the disk latency in ticks
+    int PageIn(int slot, char *into);	// Read a page from slot, return
+					// the disk latency in ticks
+    int Enqueue(int ticks);		// Queue that much disk time; return
+					// the ticks until it is done
+    int TakePoolTicks();		// Compression time since the last
+					// call
+
+  private:
+    char *fileName;			// UNIX file emulating the swap disk
+    int fileno;				// UNIX file number for it
+    BitMap *freeMap;			// Which slots are in use
+    CompressedPool *pool;		// NULL if there is none
+    int refCount[NumSwapSlots];		// Page tables referring to each slot
+    int lastSlot;			// Slot under the head after the last
+					// transfer
+    int busyUntil;			// When the queued transfers are done
+    int poolTicks;			// Compression time not yet taken
+
+    int ComputeLatency(int slot);	// Seek + rotation + transfer time
+    int WriteSlot(int slot, char *from);	// Write a page to the file
+    int Spill(int slot);		// Move a page from the pool to the file
+};
+
+#endif // SWAP_H
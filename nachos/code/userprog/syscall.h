@@ -49,6 +49,18 @@
 #define SYScall_CondOp		25
 #define SYScall_CondRemove	26
 #define SYScall_ShmAllocate	27
+#define SYScall_FutexWait	28
+#define SYScall_FutexWake	29
+#define SYScall_RasCtl		30
+#define SYScall_BarrierGet	31
+#define SYScall_BarrierWait	32
+#define SYScall_RWLockGet	33
+#define SYScall_RWLockOp	34
+#define SYScall_ShmGet		35
+#define SYScall_ShmAttach	36
+#define SYScall_ShmDetach	37
+#define SYScall_Mmap		38
+#define SYScall_Munmap		39
 #define SYScall_NumInstr        50
 
 #ifndef IN_ASM
@@ -166,10 +178,17 @@ void system_call_Sleep (unsigned);
 
 int system_call_GetTime (void);
 
-int systm_SemGet (int key);
+int system_call_SemGet (int key);
 
-void system_call_SemOp (int semid, int adjust);
+/* P (adjust < 0) or V semaphore semid. Returns -1 if there is no such
+ * semaphore.
+ */
+int system_call_SemOp (int semid, int adjust);
 
+/* Get, set or remove semaphore semid. Returns -1 if there is no such
+ * semaphore, on SYNCH_REMOVE while threads are waiting on it, or on
+ * SYNCH_SET to a negative value. Raising the value wakes that many waiters.
+ */
 int system_call_SemCtl (int semid, unsigned command, int *val);
 
 int system_call_CondGet (int key);
@@ -178,8 +197,77 @@ void system_call_CondOp (int condid, unsigned op, int semid);
 
 int system_call_CondRemove (int condid);
 
+/* Attach size bytes of fresh shared memory, inherited by forked children,
+ * and return its address.  The same as attaching a new SHM_PRIVATE segment.
+ */
 unsigned system_call_ShmAllocate (unsigned size);
 
+/* Sleep until woken by FutexWake, provided *addr still equals val.
+ * Returns 0 once woken, -1 if *addr no longer held val.
+ */
+int system_call_FutexWait (int *addr, int val);
+
+/* Wake up to count threads sleeping on addr. Returns # woken. */
+int system_call_FutexWake (int *addr, int count);
+
+/* Register [start, start+len) as a restartable atomic sequence: if the
+ * caller is switched out while executing inside it, it resumes at start.
+ */
+void system_call_RasCtl (void *start, int len);
+
+/* Get the id of the barrier named key, creating it for count
+ * participants if it does not exist yet. Returns -1 if out of barriers,
+ * or if it would be created with count <= 0.
+ */
+int system_call_BarrierGet (int key, int count);
+
+/* Block until all participants of barrier barid have arrived.
+ * Returns -1 if there is no such barrier.
+ */
+int system_call_BarrierWait (int barid);
+
+/* Get the id of the reader-writer lock named key, creating it if it
+ * does not exist yet. Returns -1 if out of locks.
+ */
+int system_call_RWLockGet (int key, int writerPreference);
+
+/* Acquire or release reader-writer lock rwid; op is one of the
+ * RWLOCK_OP_* values in synchop.h. Returns -1 if there is no such lock,
+ * op is unknown, or the lock is not held in the mode being released.
+ */
+int system_call_RWLockOp (int rwid, unsigned op);
+
+#define SHM_PRIVATE	0	/* key of a segment no other ShmGet can find */
+
+/* Get the id of the shared memory segment named key, creating it with
+ * room for size bytes if it does not exist yet. Returns -1 if out of
+ * segments, or if the segment is smaller than size. A segment persists
+ * until it has been attached and the last process using it detaches.
+ */
+int system_call_ShmGet (int key, unsigned size);
+
+/* Attach segment shmid at the page-aligned address addr, or wherever
+ * there is room if addr is 0. Returns the address, -1 on failure.
+ */
+void *system_call_ShmAttach (int shmid, void *addr);
+
+/* Detach the segment attached at addr; the last detach destroys it.
+ * Returns 0, or -1 if no segment is attached there.
+ */
+int system_call_ShmDetach (void *addr);
+
+/* Map the first length bytes of the file name into the address space,
+ * and return the address, -1 on failure.  Pages are read in on demand,
+ * and shared with other processes mapping the same file; changes are
+ * written back to the file, which is not extended.
+ */
+void *system_call_Mmap (char *name, int length);
+
+/* Unmap the file mapped at addr, writing back the changed pages.
+ * Returns 0, or -1 if no file is mapped there.
+ */
+int system_call_Munmap (void *addr);
+
 int system_call_GetNumInstr (void);
 #endif /* IN_ASM */
 
@@ -0,0 +1,113 @@
+// textcache.cc
+//	Routines to look up, enter and drop code pages in the text page
+//	cache.  The hash chains are threaded through arrays indexed by
+//	physical page number, so the cache allocates nothing per page
+//	except a copy of the executable name.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "textcache.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// TextPageCache::TextPageCache
+// 	Initialize an empty cache for "numFrames" physical pages.
+//----------------------------------------------------------------------
+
+TextPageCache::TextPageCache(int numFrames)
+{
+    int i;
+
+    fileOf = new char*[numFrames];
+    offsetOf = new int[numFrames];
+    next = new int[numFrames];
+    for (i = 0; i < numFrames; i++)
+        fileOf[i] = NULL;
+    for (i = 0; i < TEXT_CACHE_BUCKETS; i++)
+        head[i] = -1;
+}
+
+//----------------------------------------------------------------------
+// TextPageCache::~TextPageCache
+//----------------------------------------------------------------------
+
+TextPageCache::~TextPageCache()
+{
+    for (int i = 0; i < NumPhysPages; i++)
+        if (fileOf[i] != NULL) delete [] fileOf[i];
+    delete [] fileOf;
+    delete [] offsetOf;
+    delete [] next;
+}
+
+//----------------------------------------------------------------------
+// TextPageCache::Hash
+// 	Combine the characters of the file name with the page offset.
+//----------------------------------------------------------------------
+
+int
+TextPageCache::Hash(char *file, int offset)
+{
+    unsigned h = (unsigned)offset / PageSize;
+
+    while (*file != '\0')
+        h = h * 31 + *file++;
+    return h % TEXT_CACHE_BUCKETS;
+}
+
+//----------------------------------------------------------------------
+// TextPageCache::Lookup
+// 	Return the physical page holding the page at "offset" in the
+//	executable "file", or -1 if it is not resident.
+//----------------------------------------------------------------------
+
+int
+TextPageCache::Lookup(char *file, int offset)
+{
+    int frame;
+
+    for (frame = head[Hash(file, offset)]; frame != -1; frame = next[frame])
+        if ((offsetOf[frame] == offset) && !strcmp(fileOf[frame], file))
+            return frame;
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// TextPageCache::Insert
+// 	Record that physical page "frame" now holds the page at "offset"
+//	in the executable "file".
+//----------------------------------------------------------------------
+
+void
+TextPageCache::Insert(char *file, int offset, int frame)
+{
+    int bucket = Hash(file, offset);
+
+    ASSERT(fileOf[frame] == NULL);
+    fileOf[frame] = new char[strlen(file) + 1];
+    strcpy(fileOf[frame], file);
+    offsetOf[frame] = offset;
+    next[frame] = head[bucket];
+    head[bucket] = frame;
+}
+
+//----------------------------------------------------------------------
+// TextPageCache::Remove
+// 	Called when physical page "frame" is released or evicted.
+//----------------------------------------------------------------------
+
+void
+TextPageCache::Remove(int frame)
+{
+    int *ptr;
+
+    if (fileOf[frame] == NULL) return;
+    for (ptr = &head[Hash(fileOf[frame], offsetOf[frame])]; *ptr != frame; ptr = &next[*ptr])
+        ASSERT(*ptr != -1);
+    *ptr = next[frame];
+    delete [] fileOf[frame];
+    fileOf[frame] = NULL;
+}
@@ -0,0 +1,52 @@
+// textcache.h
+//	Data structures for the text page cache, which lets all the
+//	processes running the same executable share its code pages.
+//
+//	A code page is never written, so there is no reason for each
+//	process to fault in a private copy of it from the executable.
+//	The cache remembers which physical page holds the page at a
+//	given offset of a given executable; a process faulting on that
+//	page simply maps the same frame read-only.  The frame is
+//	reference counted in physicalPageMap like any other shared
+//	frame, and leaves the cache when it is released or evicted.
+//
+//	Executables are identified by name.  Another cache of the same
+//	kind (mmapCache) keeps the resident pages of memory-mapped files,
+//	keyed by file name and offset, so that processes mapping the same
+//	file share them.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef TEXTCACHE_H
+#define TEXTCACHE_H
+
+#include "copyright.h"
+
+#define TEXT_CACHE_BUCKETS	64	// Number of hash chains
+
+class TextPageCache {
+  public:
+    TextPageCache(int numFrames);	// Initialize an empty cache
+    ~TextPageCache();
+
+    int Lookup(char *file, int offset);	// Frame holding that page of the
+					// file, -1 if none
+    void Insert(char *file, int offset, int frame);
+					// Frame now holds that page
+    void Remove(int frame);		// Frame no longer holds a cached
+					// page; nothing happens if it did not
+    char *FileOf(int frame) { return fileOf[frame]; }	// Key of the page
+    int OffsetOf(int frame) { return offsetOf[frame]; }	// frame holds
+
+  private:
+    char **fileOf;			// Per frame: the executable and
+    int *offsetOf;			// offset of the page it holds,
+    int *next;				// and the next frame on its chain
+    int head[TEXT_CACHE_BUCKETS];	// First frame on each chain, -1 if none
+
+    int Hash(char *file, int offset);
+};
+
+#endif // TEXTCACHE_H
@@ -0,0 +1,163 @@
+// tlbmgr.cc
+//	Routines to refill the software-managed TLB from the page table,
+//	and to keep the page table consistent with the copies in it.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "tlbmgr.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// TLBManager::TLBManager
+// 	Start with every slot of machine->tlb invalid.
+//----------------------------------------------------------------------
+
+TLBManager::TLBManager(int algo)
+{
+    ASSERT((algo == RANDOM) || (algo == FIFO) || (algo == LRU));
+    policy = algo;
+    source = new TranslationEntry*[tlbSize];
+    lastUse = new unsigned[tlbSize];
+    for (int i = 0; i < tlbSize; i++) {
+        machine->tlb[i].valid = FALSE;
+        source[i] = NULL;
+        lastUse[i] = 0;
+    }
+    useClock = 0;
+    fifoNext = 0;
+}
+
+//----------------------------------------------------------------------
+// TLBManager::~TLBManager
+//----------------------------------------------------------------------
+
+TLBManager::~TLBManager()
+{
+    delete [] source;
+    delete [] lastUse;
+}
+
+//----------------------------------------------------------------------
+// TLBManager::ChooseSlot
+// 	Return an invalid slot if there is one, or else the slot the
+//	replacement policy picks.
+//----------------------------------------------------------------------
+
+int
+TLBManager::ChooseSlot()
+{
+    int i, victim;
+
+    for (i = 0; i < tlbSize; i++)
+        if (!machine->tlb[i].valid) return i;
+
+    switch (policy) {
+      case RANDOM:
+        return Random() % tlbSize;
+      case FIFO:
+        victim = fifoNext;
+        fifoNext = (fifoNext + 1) % tlbSize;
+        return victim;
+      default:				// LRU
+        for (victim = 0, i = 1; i < tlbSize; i++)
+            if (lastUse[i] < lastUse[victim]) victim = i;
+        return victim;
+    }
+}
+
+//----------------------------------------------------------------------
+// TLBManager::WriteBack
+// 	Merge the use and dirty bits the hardware set in "slot" into the
+//	page table entry it is a copy of.
+//----------------------------------------------------------------------
+
+void
+TLBManager::WriteBack(int slot)
+{
+    TranslationEntry *copy = &machine->tlb[slot];
+
+    if (copy->use) source[slot]->use = TRUE;
+    if (copy->dirty) source[slot]->dirty = TRUE;
+}
+
+//----------------------------------------------------------------------
+// TLBManager::Refill
+// 	Called on a TLB miss on a resident page: load a copy of the page
+//	table entry "entry" of address space "asid" into the TLB.
+//----------------------------------------------------------------------
+
+void
+TLBManager::Refill(TranslationEntry *entry, int asid)
+{
+    int slot = ChooseSlot();
+    TranslationEntry *copy = &machine->tlb[slot];
+
+    ASSERT(entry->valid);
+    if (copy->valid) WriteBack(slot);
+    if (entry->prefetched) {		// the read-ahead paid off
+        if (entry->prepaged) stats->numPrepageHits++;
+        entry->prefetched = entry->prepaged = FALSE;
+        stats->numPrefetchHits++;
+    }
+    *copy = *entry;
+    copy->use = FALSE;			// set again by the hardware
+    copy->dirty = FALSE;
+    copy->asid = asid;
+    source[slot] = entry;
+    Touch(slot);
+    stats->numTLBMisses++;
+    DEBUG('a', "TLB slot %d <- virtual page %d, physical page %d, asid %d\n",
+                slot, entry->virtualPage, entry->physicalPage, asid);
+}
+
+//----------------------------------------------------------------------
+// TLBManager::Invalidate
+// 	The kernel is about to change page table entry "entry": write
+//	back and drop any copy of it.
+//----------------------------------------------------------------------
+
+void
+TLBManager::Invalidate(TranslationEntry *entry)
+{
+    for (int i = 0; i < tlbSize; i++)
+        if (machine->tlb[i].valid && (source[i] == entry)) {
+            WriteBack(i);
+            machine->tlb[i].valid = FALSE;
+        }
+}
+
+//----------------------------------------------------------------------
+// TLBManager::Sync
+// 	The kernel is about to look at the use and dirty bits of "entry",
+//	and may clear them: write back any copy's bits, and clear them in
+//	the copy so that only later references set them again.
+//----------------------------------------------------------------------
+
+void
+TLBManager::Sync(TranslationEntry *entry)
+{
+    for (int i = 0; i < tlbSize; i++)
+        if (machine->tlb[i].valid && (source[i] == entry)) {
+            WriteBack(i);
+            machine->tlb[i].use = FALSE;
+            machine->tlb[i].dirty = FALSE;
+        }
+}
+
+//----------------------------------------------------------------------
+// TLBManager::InvalidateAsid
+// 	Address space "asid" is going away: drop all its entries.
+//----------------------------------------------------------------------
+
+void
+TLBManager::InvalidateAsid(int asid)
+{
+    for (int i = 0; i < tlbSize; i++)
+        if (machine->tlb[i].valid && (machine->tlb[i].asid == asid)) {
+            WriteBack(i);
+            machine->tlb[i].valid = FALSE;
+        }
+}
@@ -0,0 +1,59 @@
+// tlbmgr.h
+//	Data structures for the kernel half of the software-managed TLB.
+//
+//	When Nachos runs with a TLB (-tlb, or the vm build with USE_TLB),
+//	Machine::Translate looks only at the TLB; a miss raises a
+//	PageFaultException, and the kernel refills the TLB from the page
+//	table of the running process.  Only if the page is not resident
+//	does the miss become a real page fault.
+//
+//	A TLB entry is a copy of a page table entry.  The use and dirty
+//	bits the hardware sets in the copy are written back to the page
+//	table entry when the copy is replaced or invalidated, so the
+//	kernel must invalidate (or at least sync) the copies of an entry
+//	before it changes the entry or looks at its dirty bit.
+//
+//	Entries are tagged with the address space they belong to, so a
+//	context switch does not flush the TLB; an address space number
+//	is never reused, so a stale entry can never match.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef TLBMGR_H
+#define TLBMGR_H
+
+#include "copyright.h"
+#include "translate.h"
+
+class TLBManager {
+  public:
+    TLBManager(int algo);		// Manage machine->tlb, replacing
+					// entries RANDOM, FIFO or LRU
+    ~TLBManager();
+
+    void Refill(TranslationEntry *entry, int asid);
+					// Load a copy of the page table
+					// entry, replacing a slot if needed
+    void Touch(int slot) { lastUse[slot] = ++useClock; }
+					// Slot was used by a translation
+    void Invalidate(TranslationEntry *entry);
+					// Write back and drop any copy of entry
+    void Sync(TranslationEntry *entry);	// Write back the bits of any copy
+					// of entry, and clear them in the copy
+    void InvalidateAsid(int asid);	// Drop every entry of an address space
+
+  private:
+    int policy;
+    TranslationEntry **source;		// Per slot: the page table entry it
+					// is a copy of (leaves never move)
+    unsigned *lastUse;			// Per slot: value of useClock at its
+    unsigned useClock;			// last use, for LRU
+    int fifoNext;			// Next slot to replace, for FIFO
+
+    int ChooseSlot();			// Free slot, or the victim
+    void WriteBack(int slot);		// Copy use and dirty bits back
+};
+
+#endif // TLBMGR_H
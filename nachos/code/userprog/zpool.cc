@@ -0,0 +1,219 @@
+// zpool.cc
+//	Routines to compress pages into the compressed pool and to get
+//	them back.
+//
+//	The coder works a page at a time.  The compressed page is a
+//	sequence of items, each starting with a byte c:
+//
+//	    c < 0x80	c+1 literal bytes follow
+//	    c >= 0x80	copy (c & 0x7f)+MinMatch bytes from the
+//			distance given by the next byte
+//
+//	A copy may overlap the bytes it produces, so a run of a repeated
+//	byte is a literal and one copy.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "zpool.h"
+#include "system.h"
+
+#define MinMatch	3			// Shortest copy worth an item
+#define MaxMatch	(0x7f + MinMatch)
+#define MaxDistance	0xff
+
+//----------------------------------------------------------------------
+// Compress
+// 	Compress the page at "from" into "to", greedily taking the
+//	longest copy at each position.  Returns the compressed size, or
+//	-1 if it would be more than "limit" bytes.
+//----------------------------------------------------------------------
+
+static int
+Compress(unsigned char *from, unsigned char *to, int limit)
+{
+    int in = 0, out = 0, run = -1, len, best, bestDistance = 0, d;
+
+    while (in < PageSize) {
+        for (best = 0, d = 1; (d <= in) && (d <= MaxDistance); d++) {
+            for (len = 0; (in + len < PageSize) && (len < MaxMatch)
+                        && (from[in + len - d] == from[in + len]); len++);
+            if (len > best) {
+                best = len;
+                bestDistance = d;
+            }
+        }
+        if (best >= MinMatch) {
+            if (out + 2 > limit) return -1;
+            to[out++] = 0x80 | (best - MinMatch);
+            to[out++] = bestDistance;
+            in += best;
+            run = -1;
+        }
+        else {
+            if ((run == -1) || (to[run] == 0x7f)) {	// start a literal run
+                if (out + 2 > limit) return -1;
+                run = out;
+                to[out++] = 0;
+            }
+            else {
+                if (out + 1 > limit) return -1;
+                to[run]++;
+            }
+            to[out++] = from[in++];
+        }
+    }
+    return out;
+}
+
+//----------------------------------------------------------------------
+// Decompress
+// 	Expand the "size" bytes at "from" into a page at "to".
+//----------------------------------------------------------------------
+
+static void
+Decompress(unsigned char *from, int size, unsigned char *to)
+{
+    int in = 0, out = 0, n, d;
+    unsigned char c;
+
+    while (in < size) {
+        c = from[in++];
+        if (c < 0x80) {
+            for (n = c + 1; n > 0; n--)
+                to[out++] = from[in++];
+        }
+        else {
+            d = from[in++];
+            for (n = (c & 0x7f) + MinMatch; n > 0; n--, out++)
+                to[out] = to[out - d];
+        }
+    }
+    ASSERT(out == PageSize);
+}
+
+//----------------------------------------------------------------------
+// CompressedPool::CompressedPool
+// 	Create an empty pool for swap slots [0, "numSlots"), allowed to
+//	hold "maxBytes" bytes of compressed pages.
+//----------------------------------------------------------------------
+
+CompressedPool::CompressedPool(int numSlots, int maxBytes)
+{
+    budget = maxBytes;
+    used = 0;
+    data = new unsigned char*[numSlots];
+    size = new int[numSlots];
+    fill = new unsigned[numSlots];
+    prev = new int[numSlots];
+    next = new int[numSlots];
+    for (int i = 0; i < numSlots; i++) {
+        data[i] = NULL;
+        size[i] = -1;
+    }
+    head = tail = -1;
+}
+
+//----------------------------------------------------------------------
+// CompressedPool::~CompressedPool
+//----------------------------------------------------------------------
+
+CompressedPool::~CompressedPool()
+{
+    while (head != -1)
+        Drop(head);
+    delete [] data;
+    delete [] size;
+    delete [] fill;
+    delete [] prev;
+    delete [] next;
+}
+
+//----------------------------------------------------------------------
+// CompressedPool::Store
+// 	Compress the page at "from" as the contents of "slot", replacing
+//	what the pool held for it.  If the page does not compress to
+//	ZpoolMaxSize bytes, it is not stored and FALSE is returned.  The
+//	pool may be left over budget; the caller spills the oldest pages.
+//----------------------------------------------------------------------
+
+bool
+CompressedPool::Store(int slot, char *from)
+{
+    unsigned *words = (unsigned *)from;
+    unsigned char buffer[ZpoolMaxSize];
+    int i, n;
+
+    Drop(slot);
+    for (i = 1; (i < (int)(PageSize / sizeof(unsigned))) && (words[i] == words[0]); i++);
+    if (i == (int)(PageSize / sizeof(unsigned))) {	// one word, repeated
+        fill[slot] = words[0];
+        size[slot] = 0;
+        stats->numZpoolSameFilled++;
+        stats->zpoolBytesStored += sizeof(unsigned);
+    }
+    else {
+        n = Compress((unsigned char *)from, buffer, ZpoolMaxSize);
+        if (n == -1) {
+            stats->numZpoolRejects++;
+            return FALSE;
+        }
+        data[slot] = new unsigned char[n];
+        bcopy(buffer, data[slot], n);
+        size[slot] = n;
+        used += n;
+        stats->zpoolBytesStored += n;
+    }
+    prev[slot] = tail;			// newest
+    next[slot] = -1;
+    if (tail == -1) head = slot;
+    else next[tail] = slot;
+    tail = slot;
+    stats->numZpoolStores++;
+    stats->zpoolBytesIn += PageSize;
+    DEBUG('k', "Compressed swap slot %d to %d bytes\n", slot, size[slot]);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// CompressedPool::Load
+// 	Expand the contents of "slot" into the page at "into".  Returns
+//	FALSE if the pool does not hold the slot.
+//----------------------------------------------------------------------
+
+bool
+CompressedPool::Load(int slot, char *into)
+{
+    unsigned *words = (unsigned *)into;
+
+    if (size[slot] == -1) return FALSE;
+    if (data[slot] == NULL) {
+        for (unsigned i = 0; i < PageSize / sizeof(unsigned); i++)
+            words[i] = fill[slot];
+    }
+    else Decompress(data[slot], size[slot], (unsigned char *)into);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// CompressedPool::Drop
+// 	The contents of "slot" are freed or now kept elsewhere.
+//----------------------------------------------------------------------
+
+void
+CompressedPool::Drop(int slot)
+{
+    if (size[slot] == -1) return;
+    if (prev[slot] == -1) head = next[slot];
+    else next[prev[slot]] = next[slot];
+    if (next[slot] == -1) tail = prev[slot];
+    else prev[next[slot]] = prev[slot];
+    if (data[slot] != NULL) {
+        delete [] data[slot];
+        data[slot] = NULL;
+    }
+    used -= size[slot];
+    size[slot] = -1;
+}
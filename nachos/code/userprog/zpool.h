@@ -0,0 +1,54 @@
+// zpool.h
+//	Data structures for the compressed pool, a tier of the swap area
+//	kept in host memory.
+//
+//	Many of the pages evicted to the swap area are mostly zero or
+//	repetitive.  With a pool (-Z), SwapSpace::PageOut first tries to
+//	compress the page into the pool, and only writes it to the swap
+//	file if it does not compress well.  Pages that are one repeated
+//	word are stored as that word; the others with a small LZ77 coder.
+//
+//	The pool has its own budget of compressed bytes.  When a page
+//	does not fit, the pages that have been in the pool longest are
+//	spilled to their slots in the swap file.  The pool is keyed by
+//	swap slot, so sharing a slot after a fork and freeing it work as
+//	for the swap file.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef ZPOOL_H
+#define ZPOOL_H
+
+#include "copyright.h"
+
+#define ZpoolPageTime	50	// Ticks to compress or decompress a page
+#define ZpoolMaxSize	(PageSize * 3 / 4)	// Pages compressing to more
+						// than this go to the file
+
+class CompressedPool {
+  public:
+    CompressedPool(int numSlots, int maxBytes);	// Empty pool holding at
+					// most "maxBytes" compressed bytes
+    ~CompressedPool();
+
+    bool Store(int slot, char *from);	// Compress the page into the pool;
+					// FALSE if it does not compress well
+    bool Load(int slot, char *into);	// Decompress it; FALSE if not here
+    void Drop(int slot);		// Forget slot; nothing happens if
+					// it is not in the pool
+    bool OverBudget() { return (used > budget); }
+    int Oldest() { return head; }	// Slot to spill first, -1 if none
+
+  private:
+    int budget, used;			// Compressed bytes allowed and held
+    unsigned char **data;		// Per slot: compressed page, NULL if
+					// same-filled or not in the pool
+    int *size;				// Bytes in data, -1 if not in the pool
+    unsigned *fill;			// The word of a same-filled page
+    int *prev, *next;			// Stored slots, oldest first
+    int head, tail;
+};
+
+#endif // ZPOOL_H